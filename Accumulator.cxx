@@ -0,0 +1,280 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "Accumulator.h"
+
+// Copies the pixel of a target under each fragment, leaving weighting or laying it over the scene to blending
+const char* Accumulator::FRAGMENT_SHADER =
+        "#version 150\n"
+        "uniform sampler2D Source;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = texelFetch(Source, ivec2(gl_FragCoord.xy), 0);\n"
+        "}\n";
+
+/**
+ * Constructs an `Accumulator` without making any of its targets yet.
+ */
+Accumulator::Accumulator() :
+        depthBuffer(0),
+        quad(FRAGMENT_SHADER),
+        width(0),
+        height(0),
+        previous(0),
+        count(0) {
+    framebuffers[0] = framebuffers[1] = 0;
+    textures[0] = textures[1] = 0;
+    clearColor[0] = clearColor[1] = clearColor[2] = clearColor[3] = 0;
+}
+
+/**
+ * Deletes the targets.
+ */
+Accumulator::~Accumulator() {
+    dispose();
+}
+
+/**
+ * Makes the pass and average targets.
+ *
+ * Colors are kept as half floats so small weights late in the average aren't rounded away.
+ *
+ * @param width Width of the targets in pixels
+ * @param height Height of the targets in pixels
+ * @throws std::runtime_error if the targets could not be made
+ */
+void Accumulator::allocate(const GLint width, const GLint height) {
+
+    // Remove old targets
+    dispose();
+    this->width = width;
+    this->height = height;
+
+    // Save bindings
+    GLint framebuffer, texture;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+    // Make a color texture for each, and a depth buffer for the pass
+    glGenFramebuffers(2, framebuffers);
+    glGenTextures(2, textures);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+        if (i == 0) {
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            throw std::runtime_error("[Accumulator] Could not make targets!");
+        }
+    }
+
+    // Restore bindings
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/**
+ * Starts a pass by clearing the pass target and drawing there instead of the framebuffer.
+ *
+ * The depth of the framebuffer is copied in so the pass is hidden behind the same geometry, as long as the
+ * framebuffer stores depth the same way.  Otherwise the pass just isn't hidden by anything.
+ *
+ * @param clear Value to clear every channel of the pass to, which blending must leave alone
+ */
+void Accumulator::begin(const GLfloat clear) {
+
+    // Remake targets if the viewport changed size
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if ((viewport[2] != width) || (viewport[3] != height)) {
+        allocate(viewport[2], viewport[3]);
+        count = 0;
+    }
+
+    // Clear the pass
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[0]);
+    glClearColor(clear, clear, clear, clear);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Depth can only be copied between buffers stored the same way, so let that fail quietly
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glGetError();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+}
+
+/**
+ * Draws the pass over the average with a weight that keeps every pass counting the same.
+ */
+void Accumulator::blend() {
+
+    // Save state
+    GLint texture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    GLint activeTexture, sourceRgb, destinationRgb, sourceAlpha, destinationAlpha, equationRgb, equationAlpha;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &sourceRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &destinationRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &sourceAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &destinationAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &equationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &equationAlpha);
+    GLfloat blendColor[4];
+    glGetFloatv(GL_BLEND_COLOR, blendColor);
+    const GLboolean blending = glIsEnabled(GL_BLEND);
+    const GLboolean depthTesting = glIsEnabled(GL_DEPTH_TEST);
+
+    // Mix in the pass with weight 1/(n+1)
+    quad.use();
+    glUniform1i(quad.getUniformLocation("Source"), activeTexture - GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendColor(0, 0, 0, 1.0f / (count + 1));
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    quad.draw();
+
+    // Restore state
+    glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+    glBlendEquationSeparate(equationRgb, equationAlpha);
+    glBlendColor(blendColor[0], blendColor[1], blendColor[2], blendColor[3]);
+    if (!blending) {
+        glDisable(GL_BLEND);
+    }
+    if (depthTesting) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/**
+ * Deletes the targets if they were made.
+ */
+void Accumulator::dispose() {
+    if (framebuffers[0] != 0) {
+        glDeleteFramebuffers(2, framebuffers);
+        glDeleteTextures(2, textures);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        framebuffers[0] = framebuffers[1] = 0;
+        textures[0] = textures[1] = 0;
+        depthBuffer = 0;
+    }
+    width = height = 0;
+}
+
+/**
+ * Ends a pass by adding it to the average, then binds the framebuffer that was bound when the pass began.
+ */
+void Accumulator::end() {
+
+    // Put back clear color
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+    // Copy the first pass outright, then blend the rest in
+    if (count == 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+        blend();
+    }
+    ++count;
+
+    // Go back to the framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+/**
+ * Determines how many passes are in the average.
+ */
+int Accumulator::getCount() const {
+    return count;
+}
+
+/**
+ * Lays the average over the framebuffer that's bound now.
+ *
+ * @param equation Blend equation to lay the average over the framebuffer with, e.g. `GL_FUNC_ADD`
+ * @param source Blend factor for the average, e.g. `GL_ONE`
+ * @param destination Blend factor for the framebuffer, e.g. `GL_ONE_MINUS_SRC_ALPHA`
+ */
+void Accumulator::present(const GLenum equation, const GLenum source, const GLenum destination) {
+
+    // Skip if there's nothing to show yet
+    if (count == 0) {
+        return;
+    }
+
+    // Save state
+    GLint texture, activeTexture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    GLint sourceRgb, destinationRgb, sourceAlpha, destinationAlpha, equationRgb, equationAlpha;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &sourceRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &destinationRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &sourceAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &destinationAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &equationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &equationAlpha);
+    const GLboolean blending = glIsEnabled(GL_BLEND);
+    const GLboolean depthTesting = glIsEnabled(GL_DEPTH_TEST);
+
+    // Lay the average over the scene
+    quad.use();
+    glUniform1i(quad.getUniformLocation("Source"), activeTexture - GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendEquation(equation);
+    glBlendFunc(source, destination);
+    quad.draw();
+
+    // Restore state
+    glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+    glBlendEquationSeparate(equationRgb, equationAlpha);
+    if (!blending) {
+        glDisable(GL_BLEND);
+    }
+    if (depthTesting) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/**
+ * Throws away the average so the next pass starts a new one.
+ */
+void Accumulator::reset() {
+    count = 0;
+}
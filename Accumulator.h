@@ -0,0 +1,66 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_ACCUMULATOR_H
+#define GANDER_ACCUMULATOR_H
+#include <GL/glfw.h>
+#include "ScreenQuad.h"
+
+
+/**
+ * Pair of offscreen targets averaging several renderings of the same view.
+ *
+ * `begin` clears a pass target, copies in the depth of the framebuffer so the scene still hides what's behind
+ * it, and redirects drawing there, so a pass only holds what's drawn into it, like a `Compositor`.  `end`
+ * folds the pass into a running average and puts back the framebuffer.  `present` then lays the average over
+ * whatever is in the framebuffer, so the rest of the scene stays live while the average is shown again every
+ * frame.  Since the average is a plain mean, laying it over the scene with premultiplied or additive blending
+ * gives the same result as averaging the passes drawn straight into the scene.  Both targets are sized to the
+ * viewport and made again whenever it changes, which also starts the average over.
+ */
+class Accumulator {
+public:
+// Methods
+    Accumulator();
+    virtual ~Accumulator();
+    void begin(GLfloat clear);
+    void end();
+    int getCount() const;
+    void present(GLenum equation, GLenum source, GLenum destination);
+    void reset();
+private:
+// Constants
+    static const char* FRAGMENT_SHADER;
+// Attributes
+    GLuint framebuffers[2];
+    GLuint textures[2];
+    GLuint depthBuffer;
+    ScreenQuad quad;
+    GLint width;
+    GLint height;
+    GLint previous;
+    GLfloat clearColor[4];
+    int count;
+// Methods
+    Accumulator(const Accumulator&);
+    Accumulator& operator=(const Accumulator&);
+    void allocate(GLint width, GLint height);
+    void blend();
+    void dispose();
+};
+
+#endif
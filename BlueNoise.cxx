@@ -0,0 +1,175 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "BlueNoise.h"
+
+// Width of the Gaussian that measures how crowded each pixel is
+const double BlueNoise::SIGMA = 1.5;
+
+/**
+ * Finds the emptiest pixel that is off.
+ *
+ * @param pattern Which pixels are on
+ * @param energy How crowded each pixel is
+ * @return Index of pixel
+ */
+int BlueNoise::findLargestVoid(const std::vector<bool>& pattern, const std::vector<double>& energy) {
+    int best = -1;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (!pattern[i] && ((best < 0) || (energy[i] < energy[best]))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Finds the most crowded pixel that is on.
+ *
+ * @param pattern Which pixels are on
+ * @param energy How crowded each pixel is
+ * @return Index of pixel
+ */
+int BlueNoise::findTightestCluster(const std::vector<bool>& pattern, const std::vector<double>& energy) {
+    int best = -1;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] && ((best < 0) || (energy[i] > energy[best]))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Makes noise.
+ *
+ * A pattern with a tenth of its pixels on is first relaxed by moving the most crowded pixel into the
+ * emptiest spot until that stops changing anything.  Pixels are then ranked by turning them off from most
+ * crowded to least, and by turning the rest on from emptiest to fullest, and the ranks become the values.
+ *
+ * @param size Width and height of noise
+ * @param values Vector to store values in, row by row
+ * @throws std::invalid_argument if size is less than four
+ */
+void BlueNoise::generate(const int size, std::vector<unsigned char>& values) {
+
+    if (size < 4) {
+        throw std::invalid_argument("[BlueNoise] Size must be at least four!");
+    }
+    const int n = size * size;
+    std::vector<double> kernel;
+    makeKernel(size, kernel);
+
+    // Turn on some pixels, picked with a fixed linear congruential generator so the result never changes
+    std::vector<bool> pattern(n, false);
+    std::vector<double> energy(n, 0.0);
+    unsigned int seed = 1;
+    int ones = 0;
+    while (ones < (n / INITIAL_DIVISOR)) {
+        seed = (seed * 1103515245u) + 12345u;
+        const int i = (seed >> 8) % n;
+        if (!pattern[i]) {
+            pattern[i] = true;
+            splat(size, kernel, i, 1, energy);
+            ++ones;
+        }
+    }
+
+    // Spread them out, giving up after a while in case pixels keep trading places
+    for (int i = 0; i < n; ++i) {
+        const int cluster = findTightestCluster(pattern, energy);
+        pattern[cluster] = false;
+        splat(size, kernel, cluster, -1, energy);
+        const int hole = findLargestVoid(pattern, energy);
+        pattern[hole] = true;
+        splat(size, kernel, hole, 1, energy);
+        if (hole == cluster) {
+            break;
+        }
+    }
+
+    // Rank the pixels that are on by turning them off
+    std::vector<int> ranks(n);
+    std::vector<bool> remaining = pattern;
+    std::vector<double> remainingEnergy = energy;
+    for (int rank = ones - 1; rank >= 0; --rank) {
+        const int cluster = findTightestCluster(remaining, remainingEnergy);
+        remaining[cluster] = false;
+        splat(size, kernel, cluster, -1, remainingEnergy);
+        ranks[cluster] = rank;
+    }
+
+    // Rank the rest by turning them on
+    for (int rank = ones; rank < n; ++rank) {
+        const int hole = findLargestVoid(pattern, energy);
+        pattern[hole] = true;
+        splat(size, kernel, hole, 1, energy);
+        ranks[hole] = rank;
+    }
+
+    // Turn ranks into values
+    values.resize(n);
+    for (int i = 0; i < n; ++i) {
+        values[i] = (unsigned char) ((((long) ranks[i]) * 256) / n);
+    }
+}
+
+/**
+ * Makes the Gaussian each pixel that is on adds around itself, wrapping around the edges.
+ *
+ * @param size Width and height of noise
+ * @param kernel Vector to store weights in, by offset from the pixel
+ */
+void BlueNoise::makeKernel(const int size, std::vector<double>& kernel) {
+    kernel.resize(size * size);
+    for (int y = 0; y < size; ++y) {
+        const int dy = std::min(y, size - y);
+        for (int x = 0; x < size; ++x) {
+            const int dx = std::min(x, size - x);
+            kernel[(y * size) + x] = exp(-((dx * dx) + (dy * dy)) / (2 * SIGMA * SIGMA));
+        }
+    }
+}
+
+/**
+ * Adds or removes a pixel's contribution to how crowded every pixel is.
+ *
+ * @param size Width and height of noise
+ * @param kernel Weights by offset from the pixel
+ * @param index Index of pixel
+ * @param sign One to add the pixel, or negative one to remove it
+ * @param energy How crowded each pixel is
+ */
+void BlueNoise::splat(const int size,
+                      const std::vector<double>& kernel,
+                      const int index,
+                      const double sign,
+                      std::vector<double>& energy) {
+    const int px = index % size;
+    const int py = index / size;
+    for (int y = 0; y < size; ++y) {
+        const int dy = (y - py + size) % size;
+        for (int x = 0; x < size; ++x) {
+            const int dx = (x - px + size) % size;
+            energy[(y * size) + x] += sign * kernel[(dy * size) + dx];
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_BLUE_NOISE_H
+#define GANDER_BLUE_NOISE_H
+#include <vector>
+
+
+/**
+ * Makes tiling blue noise with the void-and-cluster method.
+ *
+ * Every value from 0 to 255 appears about equally often, and pixels with similar values are spread out
+ * evenly with no low frequencies, so offsetting samples by it looks like fine grain rather than blotches.
+ * The pattern wraps around at its edges, so it can be repeated across the screen.  The same pattern is made
+ * every time.
+ */
+class BlueNoise {
+public:
+// Methods
+    static void generate(int size, std::vector<unsigned char>& values);
+private:
+// Constants
+    static const double SIGMA;
+    static const int INITIAL_DIVISOR = 10;
+// Methods
+    static int findLargestVoid(const std::vector<bool>& pattern, const std::vector<double>& energy);
+    static int findTightestCluster(const std::vector<bool>& pattern, const std::vector<double>& energy);
+    static void makeKernel(int size, std::vector<double>& kernel);
+    static void splat(int size,
+                      const std::vector<double>& kernel,
+                      int index,
+                      double sign,
+                      std::vector<double>& energy);
+};
+
+#endif
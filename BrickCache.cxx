@@ -0,0 +1,404 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "BrickCache.h"
+
+/**
+ * Constructs a `BrickCache` and starts loading bricks in the background.
+ *
+ * The atlas is made as large as the capacity allows, up to the largest 3D texture supported, but never
+ * larger than needed to hold every brick of the volume.
+ *
+ * @param filename Path to brick file holding volume
+ * @param unit Ordinal of texture unit to bind atlas to
+ * @param capacity Number of bytes the atlas may use on the GPU
+ * @throws std::invalid_argument if unit is negative
+ * @throws std::runtime_error if file could not be opened, or capacity is too small for one brick
+ */
+BrickCache::BrickCache(const std::string& filename, const GLint unit, const size_t capacity) :
+        file(filename),
+        unit(unit),
+        side(file.getBrickSize() + (2 * BrickFile::APRON)),
+        slotsAcross(0),
+        texture(0),
+        generation(0),
+        stopping(false) {
+
+    if (unit < 0) {
+        throw std::invalid_argument("[BrickCache] Texture unit is negative!");
+    }
+
+    // Fit as many slots as possible in a cube
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    slotsAcross = (int) std::pow((double) (capacity / file.getSizeOfBrick()), 1.0 / 3.0);
+    while (((slotsAcross + 1) * (slotsAcross + 1) * (slotsAcross + 1)) * ((size_t) file.getSizeOfBrick()) <= capacity) {
+        ++slotsAcross;
+    }
+    if (slotsAcross > (maxSize / side)) {
+        slotsAcross = maxSize / side;
+    }
+    if (slotsAcross < 1) {
+        throw std::runtime_error("[BrickCache] Capacity is too small to hold a brick!");
+    }
+
+    // Make slots, all free at first
+    int numberOfSlots = slotsAcross * slotsAcross * slotsAcross;
+    if (numberOfSlots > file.getNumberOfBricks()) {
+        numberOfSlots = file.getNumberOfBricks();
+    }
+    slots.resize(numberOfSlots);
+    for (int i = 0; i < numberOfSlots; ++i) {
+        slots[i].brick = -1;
+        slots[i].generation = -1;
+        slots[i].position = leastRecentlyUsed.insert(leastRecentlyUsed.end(), i);
+    }
+    slotsByBrick.resize(file.getNumberOfBricks(), -1);
+    minimums.resize(file.getNumberOfBricks(), 1);
+    maximums.resize(file.getNumberOfBricks(), 0);
+
+    // Make atlas
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    const GLsizei size = slotsAcross * side;
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glActiveTexture(activeTexture);
+
+    // Start loader
+    thread.start(*this);
+}
+
+/**
+ * Stops the loader and deletes the atlas.
+ */
+BrickCache::~BrickCache() {
+    mutex.lock();
+    stopping = true;
+    condition.signal();
+    mutex.unlock();
+    thread.join();
+    glDeleteTextures(1, &texture);
+}
+
+/**
+ * Binds the atlas to its texture unit.
+ */
+void BrickCache::bind() const {
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Finds the brick along an axis that a texture coordinate falls in.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ * @param coordinate Texture coordinate along axis, which is clamped to the volume
+ * @return Index of brick along axis
+ */
+int BrickCache::findBrick(const int axis, const double coordinate) const {
+    const int index = (int) std::floor((coordinate * file.getSize(axis)) / file.getBrickSize());
+    const int last = file.getNumberOfBricks(axis) - 1;
+    return (index < 0) ? 0 : ((index > last) ? last : index);
+}
+
+/**
+ * Takes the least recently used slot, as long as it wasn't used by the last request.
+ *
+ * @return Index of slot, whose brick has been evicted, or -1 if every slot is in use
+ */
+int BrickCache::findFreeSlot() {
+    const int slot = leastRecentlyUsed.front();
+    if (slots[slot].generation == generation) {
+        return -1;
+    }
+    if (slots[slot].brick >= 0) {
+        slotsByBrick[slots[slot].brick] = -1;
+        slots[slot].brick = -1;
+    }
+    leastRecentlyUsed.splice(leastRecentlyUsed.end(), leastRecentlyUsed, slots[slot].position);
+    return slot;
+}
+
+/**
+ * Finds the smallest and largest value in a brick, including its apron.
+ *
+ * Only the rendering thread should call this, and not while `update` is running.
+ *
+ * @param brick Index of brick
+ * @param minimum Reference to store smallest value in
+ * @param maximum Reference to store largest value in
+ * @return `false` if brick has never been read
+ */
+bool BrickCache::findRange(const int brick, int& minimum, int& maximum) const {
+    if (minimums[brick] > maximums[brick]) {
+        return false;
+    }
+    minimum = minimums[brick];
+    maximum = maximums[brick];
+    return true;
+}
+
+/**
+ * Finds how to turn texture coordinates of the volume into texture coordinates of the atlas for a brick.
+ *
+ * Only the rendering thread should call this, and not while `update` is running.
+ *
+ * @param brick Index of brick
+ * @param scale Array to store factor to multiply coordinates by in
+ * @param offset Array to store amount to add to coordinates in afterwards
+ * @return `false` if brick is not in the atlas
+ */
+bool BrickCache::findTransform(const int brick, double scale[3], double offset[3]) const {
+
+    const int slot = slotsByBrick[brick];
+    if (slot < 0) {
+        return false;
+    }
+
+    const int bricks[3] = {
+        brick % file.getNumberOfBricks(0),
+        (brick / file.getNumberOfBricks(0)) % file.getNumberOfBricks(1),
+        brick / (file.getNumberOfBricks(0) * file.getNumberOfBricks(1))
+    };
+    const int slotsOf[3] = {
+        slot % slotsAcross,
+        (slot / slotsAcross) % slotsAcross,
+        slot / (slotsAcross * slotsAcross)
+    };
+    const double sizeOfAtlas = slotsAcross * side;
+    for (int i = 0; i < 3; ++i) {
+        const int start = (slotsOf[i] * side) + BrickFile::APRON - (bricks[i] * file.getBrickSize());
+        scale[i] = file.getSize(i) / sizeOfAtlas;
+        offset[i] = start / sizeOfAtlas;
+    }
+    return true;
+}
+
+/**
+ * Returns the texture coordinate where a brick starts along an axis.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ * @param index Index of brick along axis, where one past the last brick gives the end of the volume
+ */
+double BrickCache::getBrickStart(const int axis, const int index) const {
+    const double start = ((double) (index * file.getBrickSize())) / file.getSize(axis);
+    return (start > 1) ? 1 : start;
+}
+
+/**
+ * Returns the index of a brick from its position in the volume.
+ *
+ * @param x Index of brick along X
+ * @param y Index of brick along Y
+ * @param z Index of brick along Z
+ */
+int BrickCache::getIndex(const int x, const int y, const int z) const {
+    return (((z * file.getNumberOfBricks(1)) + y) * file.getNumberOfBricks(0)) + x;
+}
+
+/**
+ * Returns the number of bricks along an axis of the volume.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ */
+int BrickCache::getNumberOfBricks(const int axis) const {
+    return file.getNumberOfBricks(axis);
+}
+
+/**
+ * Returns the number of bricks the atlas can hold at once.
+ */
+int BrickCache::getNumberOfSlots() const {
+    return slots.size();
+}
+
+/**
+ * Returns the ordinal of the texture unit the atlas is bound to.
+ */
+GLint BrickCache::getUnit() const {
+    return unit;
+}
+
+/**
+ * Marks the bricks that are needed now, and queues the ones missing from the atlas for loading.
+ *
+ * Bricks queued by an earlier request that haven't been started are dropped, since the view has moved on.
+ * No more bricks are queued than the atlas can hold.
+ *
+ * @param bricks Indices of bricks in the order they should be loaded, without repeats
+ */
+void BrickCache::request(const std::vector<int>& bricks) {
+
+    Poco::Mutex::ScopedLock lock(mutex);
+
+    // Forget bricks that weren't started
+    for (std::deque<int>::const_iterator it = queue.begin(); it != queue.end(); ++it) {
+        pending.erase(*it);
+    }
+    queue.clear();
+
+    // Protect bricks in the atlas, and queue the rest
+    ++generation;
+    for (std::vector<int>::const_iterator it = bricks.begin(); it != bricks.end(); ++it) {
+        const int slot = slotsByBrick[*it];
+        if (slot >= 0) {
+            slots[slot].generation = generation;
+            leastRecentlyUsed.splice(leastRecentlyUsed.end(), leastRecentlyUsed, slots[slot].position);
+        } else if ((pending.size() < slots.size()) && pending.insert(*it).second) {
+            queue.push_back(*it);
+        }
+    }
+
+    // Wake up loader
+    if (!queue.empty()) {
+        condition.signal();
+    }
+}
+
+/**
+ * Loads queued bricks from disk until the cache is destroyed.
+ */
+void BrickCache::run() {
+    while (true) {
+
+        // Wait for a brick
+        mutex.lock();
+        while (queue.empty() && !stopping) {
+            condition.wait(mutex);
+        }
+        if (stopping) {
+            mutex.unlock();
+            return;
+        }
+        Load load;
+        load.brick = queue.front();
+        queue.pop_front();
+        mutex.unlock();
+
+        // Read it outside the lock, and find its range
+        load.voxels.resize(file.getSizeOfBrick());
+        std::string message;
+        try {
+            file.read(load.brick, &load.voxels[0]);
+            load.minimum = *std::min_element(load.voxels.begin(), load.voxels.end());
+            load.maximum = *std::max_element(load.voxels.begin(), load.voxels.end());
+        } catch (std::exception& e) {
+            message = e.what();
+        }
+
+        // Hand it over
+        mutex.lock();
+        if (message.empty()) {
+            loads.push_back(Load());
+            loads.back().brick = load.brick;
+            loads.back().minimum = load.minimum;
+            loads.back().maximum = load.maximum;
+            loads.back().voxels.swap(load.voxels);
+        } else {
+            pending.erase(load.brick);
+            error = message;
+        }
+        mutex.unlock();
+    }
+}
+
+/**
+ * Binds the atlas and copies bricks that finished loading into it.
+ *
+ * Must be called from the rendering thread.  At most a few bricks are copied each time so a burst of loads
+ * doesn't stall a frame.  Bricks that don't fit because every slot is in use are dropped.
+ *
+ * @return `true` if any bricks were added to the atlas
+ * @throws std::runtime_error if the loader could not read a brick
+ */
+bool BrickCache::update() {
+
+    bind();
+
+    // Take some loaded bricks
+    std::list<Load> loaded;
+    mutex.lock();
+    if (!error.empty()) {
+        const std::string message = error;
+        error.clear();
+        mutex.unlock();
+        throw std::runtime_error("[BrickCache] " + message);
+    }
+    while (!loads.empty() && (loaded.size() < MAX_UPLOADS_PER_UPDATE)) {
+        loaded.splice(loaded.end(), loads, loads.begin());
+        pending.erase(loaded.back().brick);
+    }
+    mutex.unlock();
+
+    // Remember their ranges
+    for (std::list<Load>::const_iterator it = loaded.begin(); it != loaded.end(); ++it) {
+        minimums[it->brick] = it->minimum;
+        maximums[it->brick] = it->maximum;
+    }
+
+    // Copy them into free slots
+    bool changed = false;
+    for (std::list<Load>::const_iterator it = loaded.begin(); it != loaded.end(); ++it) {
+        const int slot = findFreeSlot();
+        if (slot < 0) {
+            break;
+        }
+        upload(slot, *it);
+        slots[slot].brick = it->brick;
+        slots[slot].generation = generation;
+        slotsByBrick[it->brick] = slot;
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * Copies a brick into a slot of the atlas, which must be bound.
+ *
+ * @param slot Index of slot
+ * @param load Brick to copy
+ */
+void BrickCache::upload(const int slot, const Load& load) {
+    GLint activeTexture, unpackAlignment;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_3D, 0,
+                    (slot % slotsAcross) * side,
+                    ((slot / slotsAcross) % slotsAcross) * side,
+                    (slot / (slotsAcross * slotsAcross)) * side,
+                    side, side, side,
+                    GL_RED, GL_UNSIGNED_BYTE, &load.voxels[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glActiveTexture(activeTexture);
+}
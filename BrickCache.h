@@ -0,0 +1,103 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_BRICK_CACHE_H
+#define GANDER_BRICK_CACHE_H
+#include <deque>
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+#include <GL/glfw.h>
+#include <Poco/Condition.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include "BrickFile.h"
+
+
+/**
+ * Least-recently-used cache of the bricks of a large volume in a 3D texture atlas.
+ *
+ * The atlas is split into slots that each hold one brick with its apron.  Bricks are asked for with
+ * `request`, read from disk by a background thread, and copied into the atlas by `update` on the rendering
+ * thread, which replaces the least recently requested bricks once the atlas is full.  Bricks requested last
+ * time are never replaced, so anything built from `findTransform` stays valid until the next request.
+ *
+ * The smallest and largest value in each brick, including its apron, are found as it is read and kept even
+ * after it is replaced, so bricks that can't be seen don't need to be asked for again.
+ */
+class BrickCache : public Poco::Runnable {
+public:
+// Methods
+    BrickCache(const std::string& filename, GLint unit, size_t capacity);
+    virtual ~BrickCache();
+    int findBrick(int axis, double coordinate) const;
+    bool findRange(int brick, int& minimum, int& maximum) const;
+    bool findTransform(int brick, double scale[3], double offset[3]) const;
+    double getBrickStart(int axis, int index) const;
+    int getIndex(int x, int y, int z) const;
+    int getNumberOfBricks(int axis) const;
+    int getNumberOfSlots() const;
+    GLint getUnit() const;
+    void request(const std::vector<int>& bricks);
+    virtual void run();
+    bool update();
+private:
+// Constants
+    static const int MAX_UPLOADS_PER_UPDATE = 16;
+// Types
+    struct Load {
+        int brick;
+        unsigned char minimum;
+        unsigned char maximum;
+        std::vector<unsigned char> voxels;
+    };
+    struct Slot {
+        int brick;
+        int generation;
+        std::list<int>::iterator position;
+    };
+// Attributes
+    BrickFile file;
+    const GLint unit;
+    const int side;
+    int slotsAcross;
+    GLuint texture;
+    std::vector<Slot> slots;
+    std::vector<int> slotsByBrick;
+    std::vector<unsigned char> minimums;
+    std::vector<unsigned char> maximums;
+    std::list<int> leastRecentlyUsed;
+    int generation;
+    std::set<int> pending;
+    std::deque<int> queue;
+    std::list<Load> loads;
+    std::string error;
+    bool stopping;
+    Poco::Mutex mutex;
+    Poco::Condition condition;
+    Poco::Thread thread;
+// Methods
+    BrickCache(const BrickCache&);
+    BrickCache& operator=(const BrickCache&);
+    void bind() const;
+    int findFreeSlot();
+    void upload(int slot, const Load& load);
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "BrickFile.h"
+
+// Identifies a brick file
+const char BrickFile::MAGIC[] = { 'G', 'B', 'R', 'K' };
+
+/**
+ * Opens a `BrickFile` for reading.
+ *
+ * @param filename Path to file
+ * @throws std::runtime_error if file could not be opened or is not a brick file
+ */
+BrickFile::BrickFile(const std::string& filename) : stream(filename.c_str(), std::ios::in | std::ios::binary) {
+    if (!stream) {
+        throw std::runtime_error("[BrickFile] Could not open file!");
+    }
+    if (!stream.read((char*) &header, sizeof(Header)) || (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)) {
+        throw std::runtime_error("[BrickFile] File is not a brick file!");
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (header.size[i] <= 0) {
+            throw std::runtime_error("[BrickFile] Size of volume in file is invalid!");
+        }
+    }
+    if (header.brickSize <= 0) {
+        throw std::runtime_error("[BrickFile] Size of bricks in file is invalid!");
+    }
+}
+
+/**
+ * Closes a `BrickFile`.
+ */
+BrickFile::~BrickFile() {
+    // empty
+}
+
+/**
+ * Restricts a voxel coordinate to the volume.
+ *
+ * @param value Coordinate to restrict
+ * @param max Number of voxels along the axis
+ * @return Nearest coordinate in [0, max)
+ */
+int BrickFile::clamp(const int value, const int max) {
+    return (value < 0) ? 0 : ((value >= max) ? (max - 1) : value);
+}
+
+/**
+ * Splits a raw 8-bit volume into bricks and writes them to a new brick file.
+ *
+ * Only the layers of the raw volume needed for one row of bricks in Z are held in memory at a time, so
+ * volumes much larger than memory can be converted.
+ *
+ * @param rawFilename Path to raw volume, with X varying fastest
+ * @param width Number of voxels in X
+ * @param height Number of voxels in Y
+ * @param depth Number of voxels in Z
+ * @param brickSize Number of voxels along each side of a brick, not counting the apron
+ * @param filename Path to brick file to write
+ * @throws std::invalid_argument if any size is not positive
+ * @throws std::runtime_error if either file could not be opened, or raw volume is too short
+ */
+void BrickFile::create(const std::string& rawFilename,
+                       const int width,
+                       const int height,
+                       const int depth,
+                       const int brickSize,
+                       const std::string& filename) {
+
+    if ((width <= 0) || (height <= 0) || (depth <= 0)) {
+        throw std::invalid_argument("[BrickFile] Size of volume must be positive!");
+    } else if (brickSize <= 0) {
+        throw std::invalid_argument("[BrickFile] Size of bricks must be positive!");
+    }
+
+    // Open files
+    std::ifstream in(rawFilename.c_str(), std::ios::in | std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("[BrickFile] Could not open raw volume!");
+    }
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("[BrickFile] Could not open brick file for writing!");
+    }
+
+    // Write header
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.size[0] = width;
+    header.size[1] = height;
+    header.size[2] = depth;
+    header.brickSize = brickSize;
+    out.write((const char*) &header, sizeof(Header));
+
+    // Write each row of bricks in Z from the layers it covers
+    const int side = brickSize + (2 * APRON);
+    const std::streamoff sizeOfLayer = ((std::streamoff) width) * height;
+    std::vector<unsigned char> layers(side * sizeOfLayer);
+    std::vector<unsigned char> brick(side * side * side);
+    for (int bz = 0; (bz * brickSize) < depth; ++bz) {
+
+        // Read layers, repeating the first or last layer past the ends of the volume
+        const int z0 = (bz * brickSize) - APRON;
+        for (int k = 0; k < side; ++k) {
+            in.seekg(clamp(z0 + k, depth) * sizeOfLayer);
+            if (!in.read((char*) &layers[k * sizeOfLayer], sizeOfLayer)) {
+                throw std::runtime_error("[BrickFile] Raw volume is smaller than its size!");
+            }
+        }
+
+        // Copy out bricks
+        for (int by = 0; (by * brickSize) < height; ++by) {
+            const int y0 = (by * brickSize) - APRON;
+            for (int bx = 0; (bx * brickSize) < width; ++bx) {
+                const int x0 = (bx * brickSize) - APRON;
+                unsigned char* voxel = &brick[0];
+                for (int k = 0; k < side; ++k) {
+                    for (int j = 0; j < side; ++j) {
+                        const unsigned char* const row = &layers[(k * sizeOfLayer) + (clamp(y0 + j, height) * width)];
+                        for (int i = 0; i < side; ++i) {
+                            *(voxel++) = row[clamp(x0 + i, width)];
+                        }
+                    }
+                }
+                out.write((const char*) &brick[0], brick.size());
+            }
+        }
+    }
+
+    if (!out) {
+        throw std::runtime_error("[BrickFile] Could not write brick file!");
+    }
+}
+
+/**
+ * Returns the number of voxels along each side of a brick, not counting the apron.
+ */
+int BrickFile::getBrickSize() const {
+    return header.brickSize;
+}
+
+/**
+ * Returns the total number of bricks in the volume.
+ */
+int BrickFile::getNumberOfBricks() const {
+    return getNumberOfBricks(0) * getNumberOfBricks(1) * getNumberOfBricks(2);
+}
+
+/**
+ * Returns the number of bricks along an axis of the volume.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ */
+int BrickFile::getNumberOfBricks(const int axis) const {
+    return (header.size[axis] + header.brickSize - 1) / header.brickSize;
+}
+
+/**
+ * Returns the number of voxels along an axis of the volume.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ */
+int BrickFile::getSize(const int axis) const {
+    return header.size[axis];
+}
+
+/**
+ * Returns the number of bytes in each brick, including the apron.
+ */
+int BrickFile::getSizeOfBrick() const {
+    const int side = header.brickSize + (2 * APRON);
+    return side * side * side;
+}
+
+/**
+ * Reads a brick from the file.
+ *
+ * Only one thread should read from a file at a time.
+ *
+ * @param brick Index of brick, with X varying fastest
+ * @param voxels Array to store voxels of brick in, with room for `getSizeOfBrick()` bytes
+ * @throws std::out_of_range if brick is not in volume
+ * @throws std::runtime_error if brick could not be read
+ */
+void BrickFile::read(const int brick, unsigned char* const voxels) {
+    if ((brick < 0) || (brick >= getNumberOfBricks())) {
+        throw std::out_of_range("[BrickFile] Brick is not in volume!");
+    }
+    const std::streamoff sizeOfBrick = getSizeOfBrick();
+    stream.seekg(((std::streamoff) sizeof(Header)) + (brick * sizeOfBrick));
+    if (!stream.read((char*) voxels, sizeOfBrick)) {
+        stream.clear();
+        throw std::runtime_error("[BrickFile] Could not read brick!");
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_BRICK_FILE_H
+#define GANDER_BRICK_FILE_H
+#include <fstream>
+#include <string>
+
+
+/**
+ * File holding an 8-bit volume split into fixed-size bricks.
+ *
+ * The file starts with a header giving the size of the volume and of each brick, followed by the bricks in
+ * order with X varying fastest.  Each brick is stored with a one voxel apron copied from its neighbors, so a
+ * brick can be filtered on its own once it is on the GPU.  Bricks along the far edges of the volume are
+ * padded out to the full size by repeating the last voxel.
+ */
+class BrickFile {
+public:
+// Constants
+    static const int APRON = 1;
+// Methods
+    explicit BrickFile(const std::string& filename);
+    virtual ~BrickFile();
+    static void create(const std::string& rawFilename,
+                       int width,
+                       int height,
+                       int depth,
+                       int brickSize,
+                       const std::string& filename);
+    int getBrickSize() const;
+    int getNumberOfBricks() const;
+    int getNumberOfBricks(int axis) const;
+    int getSize(int axis) const;
+    int getSizeOfBrick() const;
+    void read(int brick, unsigned char* voxels);
+private:
+// Constants
+    static const char MAGIC[4];
+// Types
+    struct Header {
+        char magic[4];
+        int size[3];
+        int brickSize;
+    };
+// Attributes
+    std::ifstream stream;
+    Header header;
+// Methods
+    BrickFile(const BrickFile&);
+    BrickFile& operator=(const BrickFile&);
+    static int clamp(int value, int max);
+};
+
+#endif
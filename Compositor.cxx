@@ -0,0 +1,380 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "Compositor.h"
+
+// Keeps only fragments over pixels that are already nearly opaque, which then write the nearest depth
+const char* Compositor::MASK_SHADER =
+        "#version 150\n"
+        "uniform sampler2D Source;\n"
+        "uniform float Threshold;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = texelFetch(Source, ivec2(gl_FragCoord.xy), 0);\n"
+        "    if (FragColor.a < Threshold) {\n"
+        "        discard;\n"
+        "    }\n"
+        "}\n";
+
+// Copies the pixel of the target under each fragment, leaving laying it over the scene to blending
+const char* Compositor::COPY_SHADER =
+        "#version 150\n"
+        "uniform sampler2D Source;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = texelFetch(Source, ivec2(gl_FragCoord.xy), 0);\n"
+        "}\n";
+
+// Filters the smaller target where the scene's depth is smooth, otherwise takes the pixel at the closest depth
+const char* Compositor::UPSAMPLE_SHADER =
+        "#version 150\n"
+        "const float TOLERANCE = 0.001;\n"
+        "uniform sampler2D Source;\n"
+        "uniform sampler2D Depth;\n"
+        "uniform sampler2D SceneDepth;\n"
+        "uniform float Divisor;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    float depth = texelFetch(SceneDepth, ivec2(gl_FragCoord.xy), 0).r;\n"
+        "    vec2 position = gl_FragCoord.xy / Divisor;\n"
+        "    ivec2 size = textureSize(Source, 0);\n"
+        "    ivec2 base = ivec2(floor(position - 0.5));\n"
+        "    ivec2 closest = clamp(base, ivec2(0), size - 1);\n"
+        "    float nearest = 2.0;\n"
+        "    float farthest = 0.0;\n"
+        "    for (int i = 0; i < 4; ++i) {\n"
+        "        ivec2 texel = clamp(base + ivec2(i & 1, i >> 1), ivec2(0), size - 1);\n"
+        "        float difference = abs(texelFetch(Depth, texel, 0).r - depth);\n"
+        "        farthest = max(farthest, difference);\n"
+        "        if (difference < nearest) {\n"
+        "            nearest = difference;\n"
+        "            closest = texel;\n"
+        "        }\n"
+        "    }\n"
+        "    if (farthest < TOLERANCE) {\n"
+        "        FragColor = texture(Source, position / vec2(size));\n"
+        "    } else {\n"
+        "        FragColor = texelFetch(Source, closest, 0);\n"
+        "    }\n"
+        "}\n";
+
+/**
+ * Constructs a `Compositor` without making its target yet.
+ */
+Compositor::Compositor() :
+        colorTexture(0),
+        depthTexture(0),
+        sceneDepthTexture(0),
+        maskQuad(MASK_SHADER),
+        copyQuad(COPY_SHADER),
+        upsampleQuad(UPSAMPLE_SHADER),
+        width(0),
+        height(0),
+        divisor(1),
+        previous(0),
+        depthTesting(GL_FALSE),
+        depthWriting(GL_TRUE),
+        depthFunction(GL_LESS) {
+    framebuffers[0] = framebuffers[1] = framebuffers[2] = 0;
+    viewport[0] = viewport[1] = viewport[2] = viewport[3] = 0;
+    clearColor[0] = clearColor[1] = clearColor[2] = clearColor[3] = 0;
+}
+
+/**
+ * Deletes the target.
+ */
+Compositor::~Compositor() {
+    dispose();
+}
+
+/**
+ * Makes the target.
+ *
+ * The first two framebuffers share one depth texture.  The second has no color at all, so masking can read
+ * the colors drawn so far while writing depth without reading and writing the same texture.  The third holds
+ * a full size copy of the scene's depth for scaling the target back up, and is only made for smaller targets.
+ *
+ * @param width Width of the viewport in pixels
+ * @param height Height of the viewport in pixels
+ * @param divisor Number the size of the viewport is divided by to get the size of the target
+ * @throws std::runtime_error if the target could not be made
+ */
+void Compositor::allocate(const GLint width, const GLint height, const int divisor) {
+
+    // Remove old target
+    dispose();
+    this->width = width;
+    this->height = height;
+    this->divisor = divisor;
+
+    // Save bindings
+    GLint framebuffer, binding;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+
+    // Make textures
+    const GLint targetWidth = width / divisor;
+    const GLint targetHeight = height / divisor;
+    colorTexture = createTexture(GL_RGBA16F, GL_RGBA, GL_LINEAR, targetWidth, targetHeight);
+    depthTexture = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_NEAREST, targetWidth, targetHeight);
+    if (divisor > 1) {
+        sceneDepthTexture = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_NEAREST, width, height);
+    }
+
+    // Attach them
+    const int numberOfFramebuffers = (divisor > 1) ? 3 : 2;
+    glGenFramebuffers(numberOfFramebuffers, framebuffers);
+    for (int i = 0; i < numberOfFramebuffers; ++i) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        const GLuint depth = (i == 2) ? sceneDepthTexture : depthTexture;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        if (i == 0) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        } else {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glBindTexture(GL_TEXTURE_2D, binding);
+            throw std::runtime_error("[Compositor] Could not make target!");
+        }
+    }
+
+    // Restore bindings
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindTexture(GL_TEXTURE_2D, binding);
+}
+
+/**
+ * Starts drawing into the target.
+ *
+ * @param divisor Number the size of the viewport is divided by to get the size of the target, e.g. 1, 2, or 4
+ * @param clear Value to clear every channel of the target to, which blending must leave alone
+ * @throws std::invalid_argument if divisor is not positive
+ */
+void Compositor::begin(const int divisor, const GLfloat clear) {
+
+    if (divisor <= 0) {
+        throw std::invalid_argument("[Compositor] Divisor is not positive!");
+    }
+
+    // Remake target if the viewport or divisor changed
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if ((viewport[2] != width) || (viewport[3] != height) || (divisor != this->divisor)) {
+        allocate(viewport[2], viewport[3], divisor);
+    }
+    const GLint targetWidth = width / divisor;
+    const GLint targetHeight = height / divisor;
+
+    // Save state
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    depthTesting = glIsEnabled(GL_DEPTH_TEST);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthWriting);
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunction);
+    glDepthMask(GL_TRUE);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+
+    // Depth can only be copied between buffers stored the same way, so let that fail quietly
+    if (divisor > 1) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[2]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glGetError();
+    }
+
+    // Clear the target, then copy in the depth of the scene
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[0]);
+    glClearColor(clear, clear, clear, clear);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, targetWidth, targetHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glGetError();
+
+    // Test slices against depth without writing it
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    glViewport(0, 0, targetWidth, targetHeight);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LESS);
+}
+
+/**
+ * Makes a texture without filling it.
+ *
+ * @param internalFormat How the texture is stored, e.g. `GL_RGBA16F`
+ * @param format Kind of values in texture, e.g. `GL_RGBA`
+ * @param filter How the texture is filtered, e.g. `GL_LINEAR`
+ * @param width Width of texture in pixels
+ * @param height Height of texture in pixels
+ * @return Handle to texture, which is left bound
+ */
+GLuint Compositor::createTexture(const GLenum internalFormat,
+                                 const GLenum format,
+                                 const GLenum filter,
+                                 const GLint width,
+                                 const GLint height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+/**
+ * Deletes the target if it was made.
+ */
+void Compositor::dispose() {
+    if (framebuffers[0] != 0) {
+        glDeleteFramebuffers((divisor > 1) ? 3 : 2, framebuffers);
+        glDeleteTextures(1, &colorTexture);
+        glDeleteTextures(1, &depthTexture);
+        if (sceneDepthTexture != 0) {
+            glDeleteTextures(1, &sceneDepthTexture);
+        }
+        framebuffers[0] = framebuffers[1] = framebuffers[2] = 0;
+        colorTexture = depthTexture = sceneDepthTexture = 0;
+    }
+    width = height = 0;
+}
+
+/**
+ * Stops drawing into the target and blends it over the framebuffer that was bound when `begin` was called.
+ *
+ * @param equation Blend equation to lay the target over the framebuffer with, e.g. `GL_FUNC_ADD`
+ * @param source Blend factor for the target, e.g. `GL_ONE`
+ * @param destination Blend factor for the framebuffer, e.g. `GL_ONE_MINUS_SRC_ALPHA`
+ */
+void Compositor::end(const GLenum equation, const GLenum source, const GLenum destination) {
+
+    // Put back framebuffer, viewport, and depth state
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    glDepthFunc(depthFunction);
+    glDepthMask(depthWriting);
+
+    // Save blending
+    GLint sourceRgb, destinationRgb, sourceAlpha, destinationAlpha, equationRgb, equationAlpha;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &sourceRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &destinationRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &sourceAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &destinationAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &equationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &equationAlpha);
+    const GLboolean blending = glIsEnabled(GL_BLEND);
+
+    // Lay the target over the scene
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendEquation(equation);
+    glBlendFunc(source, destination);
+    if (divisor > 1) {
+        upsample();
+    } else {
+        GLint binding, activeTexture;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+        copyQuad.use();
+        glUniform1i(copyQuad.getUniformLocation("Source"), activeTexture - GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        copyQuad.draw();
+        glBindTexture(GL_TEXTURE_2D, binding);
+    }
+
+    // Restore blending and depth test
+    glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+    glBlendEquationSeparate(equationRgb, equationAlpha);
+    if (!blending) {
+        glDisable(GL_BLEND);
+    }
+    if (depthTesting) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+/**
+ * Stops later slices from being drawn over pixels that are already nearly opaque.
+ *
+ * @param threshold Opacity at which pixels are masked off
+ */
+void Compositor::mask(const GLfloat threshold) {
+
+    // Switch to the framebuffer without color, and read the colors drawn so far
+    GLint binding, activeTexture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+
+    // Write the nearest depth wherever opacity passed the threshold
+    maskQuad.use();
+    glUniform1i(maskQuad.getUniformLocation("Source"), activeTexture - GL_TEXTURE0);
+    glUniform1f(maskQuad.getUniformLocation("Threshold"), threshold);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    maskQuad.draw();
+
+    // Go back to drawing slices
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_FALSE);
+    glBindTexture(GL_TEXTURE_2D, binding);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+}
+
+/**
+ * Draws the smaller target at the full size of the viewport.
+ *
+ * Needs three textures at once, so borrows the last three texture units, which the scene is least likely to
+ * be using, and puts back what was bound to them afterwards.
+ */
+void Compositor::upsample() {
+
+    // Bind textures
+    GLint activeTexture, numberOfUnits;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &numberOfUnits);
+    const GLuint textures[3] = { colorTexture, depthTexture, sceneDepthTexture };
+    GLint units[3], bindings[3];
+    for (int i = 0; i < 3; ++i) {
+        units[i] = numberOfUnits - 1 - i;
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bindings[i]);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+
+    // Draw
+    upsampleQuad.use();
+    glUniform1i(upsampleQuad.getUniformLocation("Source"), units[0]);
+    glUniform1i(upsampleQuad.getUniformLocation("Depth"), units[1]);
+    glUniform1i(upsampleQuad.getUniformLocation("SceneDepth"), units[2]);
+    glUniform1f(upsampleQuad.getUniformLocation("Divisor"), (GLfloat) divisor);
+    upsampleQuad.draw();
+
+    // Restore textures
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_2D, bindings[i]);
+    }
+    glActiveTexture(activeTexture);
+}
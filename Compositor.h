@@ -0,0 +1,77 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_COMPOSITOR_H
+#define GANDER_COMPOSITOR_H
+#include <GL/glfw.h>
+#include "ScreenQuad.h"
+
+
+/**
+ * Offscreen target slices are drawn into, which is then laid over the scene.
+ *
+ * `begin` clears the target, copies in the depth of the framebuffer so the scene still hides slices behind
+ * it, and leaves the depth test on without depth writes.  `mask` marks pixels that are already nearly opaque
+ * by writing the nearest depth into them, so later slices there fail the depth test before they're shaded.
+ * `end` puts back the framebuffer and blends the target over it.
+ *
+ * The target can be a half or a quarter of the size of the viewport.  It's then scaled back up by comparing
+ * the depth of the scene at each pixel with the depths the target was drawn against.  Where they all agree
+ * the target is filtered smoothly, and elsewhere the nearest pixel at the closest depth is used, so volumes
+ * don't bleed across the edges of geometry.  Targets are made the first time they're needed and made again
+ * whenever the viewport or the scale changes.
+ */
+class Compositor {
+public:
+// Methods
+    Compositor();
+    virtual ~Compositor();
+    void begin(int divisor, GLfloat clear);
+    void end(GLenum equation, GLenum source, GLenum destination);
+    void mask(GLfloat threshold);
+private:
+// Constants
+    static const char* MASK_SHADER;
+    static const char* COPY_SHADER;
+    static const char* UPSAMPLE_SHADER;
+// Attributes
+    GLuint framebuffers[3];
+    GLuint colorTexture;
+    GLuint depthTexture;
+    GLuint sceneDepthTexture;
+    ScreenQuad maskQuad;
+    ScreenQuad copyQuad;
+    ScreenQuad upsampleQuad;
+    GLint width;
+    GLint height;
+    int divisor;
+    GLint previous;
+    GLint viewport[4];
+    GLboolean depthTesting;
+    GLboolean depthWriting;
+    GLint depthFunction;
+    GLfloat clearColor[4];
+// Methods
+    Compositor(const Compositor&);
+    Compositor& operator=(const Compositor&);
+    void allocate(GLint width, GLint height, int divisor);
+    static GLuint createTexture(GLenum internalFormat, GLenum format, GLenum filter, GLint width, GLint height);
+    void dispose();
+    void upsample();
+};
+
+#endif
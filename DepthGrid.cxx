@@ -0,0 +1,133 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <stdexcept>
+#include "DepthGrid.h"
+
+/**
+ * Constructs an empty `DepthGrid`.
+ */
+DepthGrid::DepthGrid() {
+    size[0] = size[1] = 0;
+    dimensions[0] = dimensions[1] = 0;
+}
+
+/**
+ * Destructs a `DepthGrid`.
+ */
+DepthGrid::~DepthGrid() {
+    // empty
+}
+
+/**
+ * Builds the grid from a depth image.
+ *
+ * @param depths Depth of each pixel, row by row from the bottom
+ * @param width Width of image in pixels
+ * @param height Height of image in pixels
+ * @throws std::invalid_argument if depths is `NULL` or size is not positive
+ */
+void DepthGrid::build(const float* depths, const int width, const int height) {
+
+    if (depths == NULL) {
+        throw std::invalid_argument("[DepthGrid] Depths is NULL!");
+    } else if ((width <= 0) || (height <= 0)) {
+        throw std::invalid_argument("[DepthGrid] Size is not positive!");
+    }
+
+    // Size grid to cover the whole image
+    size[0] = width;
+    size[1] = height;
+    dimensions[0] = (width + TILE_SIZE - 1) / TILE_SIZE;
+    dimensions[1] = (height + TILE_SIZE - 1) / TILE_SIZE;
+    farthest.assign(dimensions[0] * dimensions[1], 0.0f);
+
+    // Keep the farthest depth in each tile
+    for (int y = 0; y < height; ++y) {
+        const float* row = depths + (y * width);
+        float* tiles = &farthest[(y / TILE_SIZE) * dimensions[0]];
+        for (int x = 0; x < width; ++x) {
+            float& tile = tiles[x / TILE_SIZE];
+            tile = std::max(tile, row[x]);
+        }
+    }
+}
+
+/**
+ * Finds where something at a depth could be seen.
+ *
+ * @param min Lower left corner of its bounds on screen
+ * @param max Upper right corner of its bounds on screen
+ * @param depth Depth of it, which must be the same everywhere
+ * @param visibleMin Receives lower left corner of bounds of the tiles it could be seen in, within its bounds
+ * @param visibleMax Receives upper right corner of bounds of the tiles it could be seen in, within its bounds
+ * @return `false` if it's hidden everywhere, or `true` if it could be seen or the grid isn't built yet
+ */
+bool DepthGrid::findVisible(const double min[2],
+                            const double max[2],
+                            const double depth,
+                            double visibleMin[2],
+                            double visibleMax[2]) const {
+
+    // Everything could be seen without a grid
+    std::copy(min, min + 2, visibleMin);
+    std::copy(max, max + 2, visibleMax);
+    if (farthest.empty()) {
+        return true;
+    }
+
+    // Find tiles under bounds
+    int first[2], last[2];
+    for (int i = 0; i < 2; ++i) {
+        first[i] = std::max(0, std::min(dimensions[i] - 1, (int) ((min[i] * size[i]) / TILE_SIZE)));
+        last[i] = std::max(0, std::min(dimensions[i] - 1, (int) ((max[i] * size[i]) / TILE_SIZE)));
+    }
+
+    // Find bounds of tiles with something farther away
+    int tileMin[2] = { last[0] + 1, last[1] + 1 };
+    int tileMax[2] = { first[0] - 1, first[1] - 1 };
+    for (int y = first[1]; y <= last[1]; ++y) {
+        const float* tiles = &farthest[y * dimensions[0]];
+        for (int x = first[0]; x <= last[0]; ++x) {
+            if (tiles[x] > depth) {
+                tileMin[0] = std::min(tileMin[0], x);
+                tileMin[1] = std::min(tileMin[1], y);
+                tileMax[0] = std::max(tileMax[0], x);
+                tileMax[1] = std::max(tileMax[1], y);
+            }
+        }
+    }
+    if (tileMin[0] > tileMax[0]) {
+        return false;
+    }
+
+    // Shrink bounds to those tiles
+    for (int i = 0; i < 2; ++i) {
+        visibleMin[i] = std::max(min[i], ((double) (tileMin[i] * TILE_SIZE)) / size[i]);
+        visibleMax[i] = std::min(max[i], ((double) ((tileMax[i] + 1) * TILE_SIZE)) / size[i]);
+    }
+    return true;
+}
+
+/**
+ * Checks if the grid has been built.
+ */
+bool DepthGrid::isBuilt() const {
+    return !farthest.empty();
+}
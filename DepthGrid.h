@@ -0,0 +1,48 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_DEPTH_GRID_H
+#define GANDER_DEPTH_GRID_H
+#include <vector>
+
+
+/**
+ * Coarse grid of screen tiles recording the farthest depth of the scene in each.
+ *
+ * Something at a given depth can only be seen in tiles where part of the scene is farther away, so checking
+ * the tiles under its bounds on screen tells whether it's hidden completely, and if not, which smaller part of
+ * the screen it could still show up in.  Positions and depths are in window coordinates scaled to [0, 1].
+ */
+class DepthGrid {
+public:
+// Constants
+    static const int TILE_SIZE = 16;
+// Methods
+    DepthGrid();
+    virtual ~DepthGrid();
+    void build(const float* depths, int width, int height);
+    bool findVisible(const double min[2], const double max[2], double depth,
+                     double visibleMin[2], double visibleMax[2]) const;
+    bool isBuilt() const;
+private:
+// Attributes
+    int size[2];
+    int dimensions[2];
+    std::vector<float> farthest;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "GradientVolume.h"
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define GANDER_GRADIENT_VOLUME_X86
+#include <emmintrin.h>
+#endif
+
+// Longest gradient of values in [0, 1], which maps to an alpha of one
+const float GradientVolume::MAX_MAGNITUDE = 0.8660254f;
+
+// Best implementation of a row supported by this CPU
+const GradientVolume::function_t GradientVolume::FUNCTION = GradientVolume::selectFunction();
+
+/**
+ * Constructs a `GradientVolume`, making an empty texture the size of the volume.
+ *
+ * The gradients are computed by `update`, which reads the whole file, so float volumes must already have had
+ * their range found by the quantizer.  The file, quantizer and pool must outlive the gradients.
+ *
+ * @param file Volume to find the gradients of
+ * @param quantizer Converter used to normalize voxels the same way as the volume's own texture
+ * @param unit Ordinal of texture unit to bind texture to
+ * @param workerPool Workers to split each slab between
+ * @throws std::invalid_argument if unit is negative
+ */
+GradientVolume::GradientVolume(const VolumeFile& file,
+                               const Quantizer& quantizer,
+                               const GLint unit,
+                               WorkerPool& workerPool) :
+        file(file),
+        quantizer(quantizer),
+        unit(unit),
+        workerPool(workerPool),
+        texture(0),
+        layersPerSlab(1),
+        first(0),
+        count(0) {
+
+    if (unit < 0) {
+        throw std::invalid_argument("[GradientVolume] Texture unit is negative!");
+    }
+
+    // Make texture
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8,
+                 file.getSize(0), file.getSize(1), file.getSize(2), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glActiveTexture(activeTexture);
+
+    // Size slabs to whole layers
+    const size_t sizeOfLayer = ((size_t) file.getSize(0)) * file.getSize(1) * 4;
+    if (sizeOfLayer < SIZE_OF_SLAB) {
+        layersPerSlab = SIZE_OF_SLAB / sizeOfLayer;
+    }
+}
+
+/**
+ * Destructs a `GradientVolume`, deleting its texture.
+ */
+GradientVolume::~GradientVolume() {
+    glDeleteTextures(1, &texture);
+}
+
+/**
+ * Binds the texture to its texture unit.
+ */
+void GradientVolume::bind() const {
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Computes the gradients of one worker's share of the layers in the current slab.
+ *
+ * Keeps the layers below, at, and above the current one, so each layer is only normalized once per worker
+ * except for the two at the ends of its share.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void GradientVolume::computeLayers(const int worker, const int numberOfWorkers) {
+
+    // Find share of layers
+    const int begin = first + ((count * worker) / numberOfWorkers);
+    const int end = first + ((count * (worker + 1)) / numberOfWorkers);
+    if (begin >= end) {
+        return;
+    }
+
+    // Load first layers
+    const int width = file.getSize(0);
+    const int height = file.getSize(1);
+    const int depth = file.getSize(2);
+    std::vector<float> below, current, above;
+    load(std::max(begin - 1, 0), below);
+    load(begin, current);
+    load(std::min(begin + 1, depth - 1), above);
+
+    for (int z = begin; z < end; ++z) {
+
+        // Find differences of each voxel in layer
+        GLubyte* texel = &texels[((size_t) (z - first)) * width * height * 4];
+        for (int y = 0; y < height; ++y, texel += ((size_t) width) * 4) {
+            Rows rows;
+            rows.center = &current[((size_t) y) * width];
+            rows.back = &current[((size_t) std::max(y - 1, 0)) * width];
+            rows.front = &current[((size_t) std::min(y + 1, height - 1)) * width];
+            rows.below = &below[((size_t) y) * width];
+            rows.above = &above[((size_t) y) * width];
+            FUNCTION(rows, width, texel);
+        }
+
+        // Move up a layer
+        if ((z + 1) < end) {
+            below.swap(current);
+            current.swap(above);
+            load(std::min(z + 2, depth - 1), above);
+        }
+    }
+}
+
+/**
+ * Computes the gradients of part of a row one voxel at a time.
+ *
+ * @param rows Layer values of the row and of its neighbors in Y and Z
+ * @param width Number of voxels in row
+ * @param begin Index of first voxel to compute
+ * @param end Index one past last voxel to compute
+ * @param texels Texels of the whole row, which those of the voxels are stored in
+ */
+void GradientVolume::computeRange(const Rows& rows,
+                                  const int width,
+                                  const int begin,
+                                  const int end,
+                                  GLubyte* const texels) {
+    for (int x = begin; x < end; ++x) {
+        const float dx = (rows.center[std::min(x + 1, width - 1)] - rows.center[std::max(x - 1, 0)]) * 0.5f;
+        const float dy = (rows.front[x] - rows.back[x]) * 0.5f;
+        const float dz = (rows.above[x] - rows.below[x]) * 0.5f;
+        const float magnitude = std::sqrt((dx * dx) + (dy * dy) + (dz * dz));
+        const float scale = (magnitude > 0) ? (1 / magnitude) : 0;
+        GLubyte* const texel = texels + (x * 4);
+        texel[0] = encode((dx * scale * 0.5f) + 0.5f);
+        texel[1] = encode((dy * scale * 0.5f) + 0.5f);
+        texel[2] = encode((dz * scale * 0.5f) + 0.5f);
+        texel[3] = encode(magnitude / MAX_MAGNITUDE);
+    }
+}
+
+/**
+ * Computes the gradients of a row one voxel at a time.
+ *
+ * @param rows Layer values of the row and of its neighbors in Y and Z
+ * @param width Number of voxels in row
+ * @param texels Texels to store the row's gradients in
+ */
+void GradientVolume::computeRowScalar(const Rows& rows, const int width, GLubyte* const texels) {
+    computeRange(rows, width, 0, width, texels);
+}
+
+#ifdef GANDER_GRADIENT_VOLUME_X86
+/**
+ * Computes the gradients of a row four voxels at a time with SSE2.
+ *
+ * @param rows Layer values of the row and of its neighbors in Y and Z
+ * @param width Number of voxels in row
+ * @param texels Texels to store the row's gradients in
+ */
+__attribute__((target("sse2")))
+void GradientVolume::computeRowSse2(const Rows& rows, const int width, GLubyte* const texels) {
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 bytes = _mm_set1_ps(255.0f);
+    const __m128 inverseOfMax = _mm_set1_ps(1 / MAX_MAGNITUDE);
+
+    // Do the first voxel on its own, since its neighbor in X is clamped
+    computeRange(rows, width, 0, std::min(1, width), texels);
+
+    // Do four voxels at a time while both neighbors in X are inside the row
+    int x = 1;
+    for (; (x + 4) < width; x += 4) {
+
+        // Take differences
+        const __m128 dx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows.center + x + 1),
+                                                _mm_loadu_ps(rows.center + x - 1)), half);
+        const __m128 dy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows.front + x),
+                                                _mm_loadu_ps(rows.back + x)), half);
+        const __m128 dz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows.above + x),
+                                                _mm_loadu_ps(rows.below + x)), half);
+
+        // Find length, and one over it where it isn't zero
+        const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        const __m128 magnitude = _mm_sqrt_ps(sum);
+        const __m128 scale = _mm_and_ps(_mm_div_ps(one, magnitude), _mm_cmpgt_ps(magnitude, zero));
+
+        // Map to [0, 1], then round to bytes
+        __m128 values[4];
+        values[0] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(dx, scale), half), half);
+        values[1] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(dy, scale), half), half);
+        values[2] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(dz, scale), half), half);
+        values[3] = _mm_mul_ps(magnitude, inverseOfMax);
+        __m128i packed = _mm_setzero_si128();
+        for (int c = 0; c < 4; ++c) {
+            const __m128 clamped = _mm_min_ps(_mm_max_ps(values[c], zero), one);
+            const __m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, bytes), half));
+            packed = _mm_or_si128(packed, _mm_slli_epi32(rounded, c * 8));
+        }
+
+        // Store four RGBA texels
+        _mm_storeu_si128((__m128i*) (texels + (x * 4)), packed);
+    }
+
+    // Do the rest one at a time
+    computeRange(rows, width, x, width, texels);
+}
+#else
+/**
+ * Computes the gradients of a row one voxel at a time, since SSE2 isn't available on this platform.
+ *
+ * @param rows Layer values of the row and of its neighbors in Y and Z
+ * @param width Number of voxels in row
+ * @param texels Texels to store the row's gradients in
+ */
+void GradientVolume::computeRowSse2(const Rows& rows, const int width, GLubyte* const texels) {
+    computeRowScalar(rows, width, texels);
+}
+#endif
+
+/**
+ * Converts a value in [0, 1] to the nearest byte.
+ */
+GLubyte GradientVolume::encode(const float value) {
+    const float clamped = (value > 0) ? ((value < 1) ? value : 1) : 0;
+    return (GLubyte) ((clamped * 255) + 0.5f);
+}
+
+/**
+ * Returns the ordinal of the texture unit the texture is bound to.
+ */
+GLint GradientVolume::getUnit() const {
+    return unit;
+}
+
+/**
+ * Checks if the gradients of the whole volume have been sent to the texture.
+ */
+bool GradientVolume::isComplete() const {
+    return first >= file.getSize(2);
+}
+
+/**
+ * Reads a layer of the file and normalizes it.
+ *
+ * @param z Index of layer
+ * @param values Vector to store normalized values in, resized to fit the layer
+ */
+void GradientVolume::load(const int z, std::vector<float>& values) const {
+    const size_t voxelsPerLayer = ((size_t) file.getSize(0)) * file.getSize(1);
+    values.resize(voxelsPerLayer);
+    quantizer.normalize(file.getLayer(z), voxelsPerLayer, &values[0]);
+}
+
+/**
+ * Picks the best implementation of a row this CPU supports.
+ */
+GradientVolume::function_t GradientVolume::selectFunction() {
+#ifdef GANDER_GRADIENT_VOLUME_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return &computeRowSse2;
+    }
+#endif
+    return &computeRowScalar;
+}
+
+/**
+ * Computes the gradients of the next slab of layers on the workers and sends them to the texture.
+ *
+ * Must be called from the rendering thread.
+ *
+ * @return `true` if the last slab was just sent
+ */
+bool GradientVolume::update() {
+
+    // Skip if already done
+    if (isComplete()) {
+        return false;
+    }
+
+    // Compute slab
+    const int width = file.getSize(0);
+    const int height = file.getSize(1);
+    const int depth = file.getSize(2);
+    count = std::min(layersPerSlab, depth - first);
+    texels.resize(((size_t) width) * height * count * 4);
+    workerPool.run(this, &GradientVolume::computeLayers);
+
+    // Send it
+    GLint activeTexture, unpackAlignment;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, first, width, height, count, GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glActiveTexture(activeTexture);
+
+    // Move on, and have the system read ahead for the next slab
+    first += count;
+    file.prefetch(first + 1, layersPerSlab);
+    if (!isComplete()) {
+        return false;
+    }
+
+    // Free slab once done
+    std::vector<GLubyte>().swap(texels);
+    return true;
+}
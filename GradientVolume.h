@@ -0,0 +1,85 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_GRADIENT_VOLUME_H
+#define GANDER_GRADIENT_VOLUME_H
+#include <vector>
+#include <GL/glfw.h>
+#include "Quantizer.h"
+#include "VolumeFile.h"
+#include "WorkerPool.h"
+
+
+/**
+ * 3D texture of the gradients of a volume file, computed once when it is loaded.
+ *
+ * Gradients are central differences of the normalized voxels, with voxels past the edges clamped to the
+ * edges.  Each texel holds the direction of the gradient mapped from [-1, 1] to [0, 1] in RGB and its length
+ * over `MAX_MAGNITUDE` in A, so a shader can find a normal from one fetch instead of six.
+ *
+ * Like `VolumeUploader`, the texture is filled a slab of layers at a time by `update`, so the volume can be
+ * drawn while the gradients are still being computed.  The layers of each slab are split between workers in
+ * contiguous runs, and each row is computed four voxels at a time with SSE2 when the CPU supports it.
+ * Layers that haven't been computed yet are whatever the driver filled the texture with, normally zero.
+ */
+class GradientVolume {
+public:
+// Constants
+    static const float MAX_MAGNITUDE;
+// Methods
+    GradientVolume(const VolumeFile& file, const Quantizer& quantizer, GLint unit, WorkerPool& workerPool);
+    virtual ~GradientVolume();
+    void bind() const;
+    GLint getUnit() const;
+    bool isComplete() const;
+    bool update();
+private:
+// Types
+    struct Rows {
+        const float* center;
+        const float* back;
+        const float* front;
+        const float* below;
+        const float* above;
+    };
+    typedef void (*function_t)(const Rows& rows, int width, GLubyte* texels);
+// Constants
+    static const size_t SIZE_OF_SLAB = 16 * 1024 * 1024;
+    static const function_t FUNCTION;
+// Attributes
+    const VolumeFile& file;
+    const Quantizer& quantizer;
+    const GLint unit;
+    WorkerPool& workerPool;
+    GLuint texture;
+    std::vector<GLubyte> texels;
+    int layersPerSlab;
+    int first;
+    int count;
+// Methods
+    GradientVolume(const GradientVolume&);
+    GradientVolume& operator=(const GradientVolume&);
+    void computeLayers(int worker, int numberOfWorkers);
+    static void computeRange(const Rows& rows, int width, int begin, int end, GLubyte* texels);
+    static void computeRowScalar(const Rows& rows, int width, GLubyte* texels);
+    static void computeRowSse2(const Rows& rows, int width, GLubyte* texels);
+    static GLubyte encode(float value);
+    void load(int z, std::vector<float>& values) const;
+    static function_t selectFunction();
+};
+
+#endif
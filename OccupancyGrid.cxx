@@ -0,0 +1,346 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <stdexcept>
+#include "OccupancyGrid.h"
+#include "Quantizer.h"
+#include "VolumeFile.h"
+#include "WorkerPool.h"
+
+/**
+ * Constructs an empty `OccupancyGrid`.
+ */
+OccupancyGrid::OccupancyGrid() :
+        loaded(0),
+        file(NULL),
+        quantizer(NULL),
+        firstLayer(0),
+        lastLayer(0),
+        firstBrick(0),
+        lastBrick(0) {
+    for (int i = 0; i < 3; ++i) {
+        size[i] = 0;
+        dimensions[i] = 0;
+    }
+}
+
+/**
+ * Destructs an `OccupancyGrid`.
+ */
+OccupancyGrid::~OccupancyGrid() {
+    // empty
+}
+
+/**
+ * Widens the ranges of the bricks touched by some layers of a volume's file.
+ *
+ * Values are normalized by the quantizer and rounded to a byte, the same as reading the texture back as bytes
+ * would give.  Bricks are spread over the workers by rows, and each brick also looks one voxel past its edges
+ * since samples there are blended with its neighbors.  Once the last layer is added the grid is built, with
+ * any opacities set before applied to it.
+ *
+ * @param file Volume file holding the layers
+ * @param quantizer Converter for the file's voxels, which must have found its range already
+ * @param first Index of first layer to add
+ * @param count Number of layers to add
+ * @param workerPool Workers to split bricks between
+ * @throws std::invalid_argument if the layers are not in the volume passed to `begin`
+ */
+void OccupancyGrid::add(const VolumeFile& file,
+                        const Quantizer& quantizer,
+                        const int first,
+                        const int count,
+                        WorkerPool& workerPool) {
+
+    if ((first < 0) || (count <= 0) || ((first + count) > size[2])) {
+        throw std::invalid_argument("[OccupancyGrid] Layers are outside of volume!");
+    } else if ((file.getSize(0) != size[0]) || (file.getSize(1) != size[1]) || (file.getSize(2) != size[2])) {
+        throw std::invalid_argument("[OccupancyGrid] File is a different size than volume!");
+    }
+
+    // Find bricks whose voxels, including the ones past each side, overlap the layers
+    firstLayer = first;
+    lastLayer = first + count - 1;
+    firstBrick = std::max(((firstLayer + BRICK_SIZE - 1) / BRICK_SIZE) - 1, 0);
+    lastBrick = std::min((lastLayer + 1) / BRICK_SIZE, dimensions[2] - 1);
+
+    // Widen their ranges on the workers
+    this->file = &file;
+    this->quantizer = &quantizer;
+    workerPool.run(this, &OccupancyGrid::addRows);
+    this->file = NULL;
+    this->quantizer = NULL;
+
+    // Apply opacities once every layer is in, or treat everything as occupied without any
+    loaded += count;
+    if (!isBuilt()) {
+        return;
+    } else if (opacities.empty()) {
+        sum();
+    } else {
+        const std::vector<float> current = opacities;
+        opacities.clear();
+        update(current);
+    }
+}
+
+/**
+ * Widens the ranges of the bricks in one worker's share of rows of bricks.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void OccupancyGrid::addRows(const int worker, const int numberOfWorkers) {
+
+    const size_t bytesPerRow = ((size_t) size[0]) * file->getBytesPerVoxel();
+    const int numberOfRows = ((lastBrick - firstBrick) + 1) * dimensions[1];
+    std::vector<float> values(size[0]);
+    std::vector<unsigned char> bytes(size[0]);
+    for (int row = worker; row < numberOfRows; row += numberOfWorkers) {
+        const int bz = firstBrick + (row / dimensions[1]);
+        const int by = row % dimensions[1];
+
+        // Find voxels covered by row of bricks and layers, including one past each side of the bricks
+        const int z1 = std::max(std::max((bz * BRICK_SIZE) - 1, 0), firstLayer);
+        const int z2 = std::min(std::min((bz + 1) * BRICK_SIZE, size[2] - 1), lastLayer);
+        const int y1 = std::max((by * BRICK_SIZE) - 1, 0);
+        const int y2 = std::min((by + 1) * BRICK_SIZE, size[1] - 1);
+
+        // Widen range of each brick in row by the values it covers
+        for (int z = z1; z <= z2; ++z) {
+            for (int y = y1; y <= y2; ++y) {
+                quantizer->normalize(file->getLayer(z) + (y * bytesPerRow), size[0], &values[0]);
+                for (int x = 0; x < size[0]; ++x) {
+                    bytes[x] = (unsigned char) ((values[x] * 255) + 0.5f);
+                }
+                for (int bx = 0; bx < dimensions[0]; ++bx) {
+                    const int x1 = std::max((bx * BRICK_SIZE) - 1, 0);
+                    const int x2 = std::min((bx + 1) * BRICK_SIZE, size[0] - 1);
+                    const int index = (((bz * dimensions[1]) + by) * dimensions[0]) + bx;
+                    unsigned char minimum = minimums[index];
+                    unsigned char maximum = maximums[index];
+                    for (int x = x1; x <= x2; ++x) {
+                        minimum = std::min(minimum, bytes[x]);
+                        maximum = std::max(maximum, bytes[x]);
+                    }
+                    minimums[index] = minimum;
+                    maximums[index] = maximum;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Starts a new grid for a volume, with no layers added yet.
+ *
+ * @param width Number of voxels in X
+ * @param height Number of voxels in Y
+ * @param depth Number of voxels in Z
+ * @throws std::invalid_argument if any size is not positive
+ */
+void OccupancyGrid::begin(const int width, const int height, const int depth) {
+
+    if ((width <= 0) || (height <= 0) || (depth <= 0)) {
+        throw std::invalid_argument("[OccupancyGrid] Size must be positive!");
+    }
+
+    // Size grid
+    size[0] = width;
+    size[1] = height;
+    size[2] = depth;
+    for (int i = 0; i < 3; ++i) {
+        dimensions[i] = (size[i] + BRICK_SIZE - 1) / BRICK_SIZE;
+    }
+
+    // Start with empty ranges, which the layers widen
+    const int numberOfBricks = dimensions[0] * dimensions[1] * dimensions[2];
+    minimums.assign(numberOfBricks, 255);
+    maximums.assign(numberOfBricks, 0);
+    occupied.assign(numberOfBricks, 1);
+    sums.clear();
+    loaded = 0;
+}
+
+/**
+ * Counts the occupied bricks in a box of bricks.
+ *
+ * @param min Index of first brick in each direction
+ * @param max Index of last brick in each direction
+ * @return Number of occupied bricks in box
+ */
+int OccupancyGrid::count(const int min[3], const int max[3]) const {
+    const int x1 = min[0], y1 = min[1], z1 = min[2];
+    const int x2 = max[0] + 1, y2 = max[1] + 1, z2 = max[2] + 1;
+    return getSum(x2, y2, z2)
+         - getSum(x1, y2, z2) - getSum(x2, y1, z2) - getSum(x2, y2, z1)
+         + getSum(x1, y1, z2) + getSum(x1, y2, z1) + getSum(x2, y1, z1)
+         - getSum(x1, y1, z1);
+}
+
+/**
+ * Decides if a brick is occupied using the current opacities.
+ *
+ * @param brick Index of brick
+ */
+void OccupancyGrid::evaluate(const int brick) {
+    occupied[brick] = (counts[maximums[brick] + 1] - counts[minimums[brick]]) > 0;
+}
+
+/**
+ * Finds the part of a box that has occupied bricks in it.
+ *
+ * @param min Lower corner of box in texture coordinates
+ * @param max Upper corner of box in texture coordinates
+ * @param boundsMin Lower corner of occupied bricks in box in texture coordinates
+ * @param boundsMax Upper corner of occupied bricks in box in texture coordinates
+ * @return `true` if any brick in box is occupied
+ */
+bool OccupancyGrid::findBounds(const double min[3],
+                               const double max[3],
+                               double boundsMin[3],
+                               double boundsMax[3]) const {
+
+    // Find bricks touched by box
+    int lower[3];
+    int upper[3];
+    for (int i = 0; i < 3; ++i) {
+        const double scale = ((double) size[i]) / BRICK_SIZE;
+        lower[i] = std::max(0, std::min((int) (min[i] * scale), dimensions[i] - 1));
+        upper[i] = std::max(0, std::min((int) (max[i] * scale), dimensions[i] - 1));
+    }
+
+    // Check if anything is there at all
+    if (count(lower, upper) == 0) {
+        return false;
+    }
+
+    // Shrink each side while the layer of bricks along it is empty
+    for (int i = 0; i < 3; ++i) {
+        int layerMin[3];
+        int layerMax[3];
+        std::copy(lower, lower + 3, layerMin);
+        std::copy(upper, upper + 3, layerMax);
+        layerMax[i] = lower[i];
+        while (count(layerMin, layerMax) == 0) {
+            ++lower[i];
+            layerMin[i] = layerMax[i] = lower[i];
+        }
+        layerMin[i] = layerMax[i] = upper[i];
+        while (count(layerMin, layerMax) == 0) {
+            --upper[i];
+            layerMin[i] = layerMax[i] = upper[i];
+        }
+    }
+
+    // Convert back to texture coordinates
+    for (int i = 0; i < 3; ++i) {
+        boundsMin[i] = ((double) (lower[i] * BRICK_SIZE)) / size[i];
+        boundsMax[i] = std::min(((double) ((upper[i] + 1) * BRICK_SIZE)) / size[i], 1.0);
+    }
+    return true;
+}
+
+/**
+ * Looks up a value in the summed-volume table.
+ *
+ * @param x Number of bricks in X to sum
+ * @param y Number of bricks in Y to sum
+ * @param z Number of bricks in Z to sum
+ * @return Number of occupied bricks with smaller indices in all directions
+ */
+int OccupancyGrid::getSum(const int x, const int y, const int z) const {
+    return sums[(((z * (dimensions[1] + 1)) + y) * (dimensions[0] + 1)) + x];
+}
+
+/**
+ * Checks if the grid has been built, which happens once every layer of the volume has been added.
+ */
+bool OccupancyGrid::isBuilt() const {
+    return (size[2] > 0) && (loaded >= size[2]);
+}
+
+/**
+ * Recomputes the summed-volume table from the occupied bricks.
+ */
+void OccupancyGrid::sum() {
+    const int nx = dimensions[0] + 1;
+    const int ny = dimensions[1] + 1;
+    const int nz = dimensions[2] + 1;
+    sums.assign(nx * ny * nz, 0);
+    for (int z = 1; z < nz; ++z) {
+        for (int y = 1; y < ny; ++y) {
+            for (int x = 1; x < nx; ++x) {
+                const int brick = ((((z - 1) * dimensions[1]) + (y - 1)) * dimensions[0]) + (x - 1);
+                sums[(((z * ny) + y) * nx) + x] = occupied[brick]
+                        + getSum(x - 1, y, z) + getSum(x, y - 1, z) + getSum(x, y, z - 1)
+                        - getSum(x - 1, y - 1, z) - getSum(x - 1, y, z - 1) - getSum(x, y - 1, z - 1)
+                        + getSum(x - 1, y - 1, z - 1);
+            }
+        }
+    }
+}
+
+/**
+ * Changes the opacities values map to, and updates which bricks are occupied.
+ *
+ * Only bricks whose range of values overlaps the values that changed are looked at again.
+ *
+ * @param opacities Opacity of each value, with one entry per bin
+ * @throws std::invalid_argument if the number of opacities is not `NUMBER_OF_BINS`
+ */
+void OccupancyGrid::update(const std::vector<float>& opacities) {
+
+    if (opacities.size() != NUMBER_OF_BINS) {
+        throw std::invalid_argument("[OccupancyGrid] Wrong number of opacities!");
+    }
+
+    // Find range of values that changed
+    int first = 0;
+    int last = NUMBER_OF_BINS - 1;
+    if (this->opacities.size() == NUMBER_OF_BINS) {
+        while ((first <= last) && ((this->opacities[first] > 0) == (opacities[first] > 0))) {
+            ++first;
+        }
+        while ((last >= first) && ((this->opacities[last] > 0) == (opacities[last] > 0))) {
+            --last;
+        }
+    }
+    this->opacities = opacities;
+
+    // Count visible values so any range can be checked at once
+    counts.assign(NUMBER_OF_BINS + 1, 0);
+    for (int i = 0; i < NUMBER_OF_BINS; ++i) {
+        counts[i + 1] = counts[i] + (opacities[i] > 0);
+    }
+
+    // Skip bricks if nothing visible changed or there are no bricks yet
+    if ((first > last) || !isBuilt()) {
+        return;
+    }
+
+    // Look at bricks whose values overlap the change
+    const int numberOfBricks = minimums.size();
+    for (int i = 0; i < numberOfBricks; ++i) {
+        if ((minimums[i] <= last) && (maximums[i] >= first)) {
+            evaluate(i);
+        }
+    }
+    sum();
+}
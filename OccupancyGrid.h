@@ -0,0 +1,73 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_OCCUPANCY_GRID_H
+#define GANDER_OCCUPANCY_GRID_H
+#include <vector>
+class Quantizer;
+class VolumeFile;
+class WorkerPool;
+
+
+/**
+ * Coarse grid of bricks recording which parts of a volume can be seen.
+ *
+ * The smallest and largest value in each brick are found from the volume's file as its layers are loaded, so
+ * the volume never has to be read back from its texture, and the grid is built once every layer is in.  A
+ * brick is occupied if any value in its range maps to a non-zero opacity, so when the opacities change only
+ * bricks whose range overlaps the values that changed need to be looked at again.  A summed-volume table over
+ * the bricks answers whether a box of bricks is empty in constant time.
+ */
+class OccupancyGrid {
+public:
+// Constants
+    static const int BRICK_SIZE = 16;
+    static const int NUMBER_OF_BINS = 256;
+// Methods
+    OccupancyGrid();
+    virtual ~OccupancyGrid();
+    void add(const VolumeFile& file, const Quantizer& quantizer, int first, int count, WorkerPool& workerPool);
+    void begin(int width, int height, int depth);
+    bool findBounds(const double min[3], const double max[3], double boundsMin[3], double boundsMax[3]) const;
+    bool isBuilt() const;
+    void update(const std::vector<float>& opacities);
+private:
+// Attributes
+    int size[3];
+    int dimensions[3];
+    std::vector<unsigned char> minimums;
+    std::vector<unsigned char> maximums;
+    std::vector<unsigned char> occupied;
+    std::vector<int> sums;
+    std::vector<int> counts;
+    std::vector<float> opacities;
+    int loaded;
+    const VolumeFile* file;
+    const Quantizer* quantizer;
+    int firstLayer;
+    int lastLayer;
+    int firstBrick;
+    int lastBrick;
+// Methods
+    void addRows(int worker, int numberOfWorkers);
+    int count(const int min[3], const int max[3]) const;
+    void evaluate(int brick);
+    int getSum(int x, int y, int z) const;
+    void sum();
+};
+
+#endif
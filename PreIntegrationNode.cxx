@@ -0,0 +1,228 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "PreIntegrationNode.h"
+#include "TransferFunction.h"
+
+// Largest opacity of a transfer function entry, so its optical depth stays finite
+const GLfloat PreIntegrationNode::MAX_OPACITY = 0.9999f;
+
+/**
+ * Constructs a `PreIntegrationNode`.
+ *
+ * @param textureId Identifier of texture node holding the transfer function
+ * @param unit Texture unit to bind the table to
+ * @throws std::invalid_argument if texture identifier is empty or unit is negative
+ */
+PreIntegrationNode::PreIntegrationNode(const std::string& textureId, GLint unit) :
+        ready(false),
+        dirty(true),
+        textureId(textureId),
+        unit(unit),
+        textureNode(NULL),
+        sourceUnit(-1),
+        texture(0) {
+    if (textureId.empty()) {
+        throw std::invalid_argument("[PreIntegrationNode] Texture identifier is empty!");
+    } else if (unit < 0) {
+        throw std::invalid_argument("[PreIntegrationNode] Unit is negative!");
+    }
+}
+
+/**
+ * Destructs a `PreIntegrationNode`, no longer observing the texture node.
+ */
+PreIntegrationNode::~PreIntegrationNode() {
+    if (textureNode != NULL) {
+        textureNode->removeNodeListener(this);
+    }
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+/**
+ * Returns the identifier of the texture node holding the transfer function.
+ */
+std::string PreIntegrationNode::getTextureId() const {
+    return textureId;
+}
+
+/**
+ * Returns the texture unit the table is bound to.
+ */
+GLint PreIntegrationNode::getUnit() const {
+    return unit;
+}
+
+/**
+ * Builds a pre-integrated table from a transfer function.
+ *
+ * Each entry's opacity is turned into an optical depth, and running sums of the depth and of the depth
+ * weighted by color are kept along the transfer function.  A slab between two samples then only needs the
+ * difference of two sums, assuming the value varies linearly through the slab, which makes building the
+ * whole table quadratic rather than cubic in the size of the transfer function.  Color is weighted by depth
+ * without attenuation inside the slab, which is close enough for slabs as thin as the ones drawn.
+ *
+ * @param transferFunction RGBA entries of the transfer function, with straight color
+ * @param table Vector to store the RGBA entries of the table in, with premultiplied color
+ * @throws std::invalid_argument if transfer function is empty or not made of RGBA entries
+ */
+void PreIntegrationNode::integrate(const std::vector<GLfloat>& transferFunction, std::vector<GLfloat>& table) {
+
+    // Check size
+    if (transferFunction.empty() || ((transferFunction.size() % 4) != 0)) {
+        throw std::invalid_argument("[PreIntegrationNode] Transfer function must be made of RGBA entries!");
+    }
+    const int n = transferFunction.size() / 4;
+
+    // Find optical depth of each entry
+    std::vector<double> depths(n);
+    for (int i = 0; i < n; ++i) {
+        const double alpha = std::max(0.0f, std::min(transferFunction[i * 4 + 3], MAX_OPACITY));
+        depths[i] = -log(1 - alpha);
+    }
+
+    // Sum depth and depth weighted by color, integrating between entries with the trapezoid rule
+    std::vector<double> sums((n + 1) * 4, 0.0);
+    for (int i = 1; i < n; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const double before = depths[i - 1] * transferFunction[(i - 1) * 4 + c];
+            const double after = depths[i] * transferFunction[i * 4 + c];
+            sums[i * 4 + c] = sums[(i - 1) * 4 + c] + (before + after) * 0.5;
+        }
+        sums[i * 4 + 3] = sums[(i - 1) * 4 + 3] + (depths[i - 1] + depths[i]) * 0.5;
+    }
+
+    // Fill in table
+    table.resize(n * n * 4);
+    for (int back = 0; back < n; ++back) {
+        for (int front = 0; front < n; ++front) {
+            GLfloat* const entry = &table[(back * n + front) * 4];
+
+            // Same sample at both ends, so just use the entry
+            if (front == back) {
+                const GLfloat alpha = transferFunction[front * 4 + 3];
+                for (int c = 0; c < 3; ++c) {
+                    entry[c] = transferFunction[front * 4 + c] * alpha;
+                }
+                entry[3] = alpha;
+                continue;
+            }
+
+            // Average depth and weighted color over the range of values in the slab
+            const int lo = std::min(front, back);
+            const int hi = std::max(front, back);
+            const double depth = sums[hi * 4 + 3] - sums[lo * 4 + 3];
+            const double alpha = 1 - exp(-depth / (hi - lo));
+            for (int c = 0; c < 3; ++c) {
+                if (depth > 1e-9) {
+                    entry[c] = (GLfloat) (alpha * (sums[hi * 4 + c] - sums[lo * 4 + c]) / depth);
+                } else {
+                    const double color = (transferFunction[lo * 4 + c] + transferFunction[hi * 4 + c]) * 0.5;
+                    entry[c] = (GLfloat) (alpha * color);
+                }
+            }
+            entry[3] = (GLfloat) alpha;
+        }
+    }
+}
+
+/**
+ * Marks the table as needing to be rebuilt before the next time it's used.
+ */
+void PreIntegrationNode::invalidate() {
+    dirty = true;
+}
+
+/**
+ * Rebuilds the table when the texture node holding the transfer function changes.
+ *
+ * @param node Node that changed
+ */
+void PreIntegrationNode::nodeChanged(RapidGL::Node* node) {
+    dirty = true;
+}
+
+/**
+ * Finds the transfer function and rebuilds the table if needed.
+ *
+ * @param state State of the scene
+ * @throws std::runtime_error if texture node could not be found
+ */
+void PreIntegrationNode::preVisit(RapidGL::State& state) {
+
+    // Find texture node and make table texture the first time
+    if (!ready) {
+        textureNode = RapidGL::findAncestor<RapidGL::TextureNode>(this, textureId);
+        if (textureNode == NULL) {
+            throw std::runtime_error("[PreIntegrationNode] Could not find texture node!");
+        }
+        sourceUnit = textureNode->getTextureUnit().toOrdinal();
+        textureNode->addNodeListener(this);
+        glGenTextures(1, &texture);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        ready = true;
+    }
+
+    // Rebuild table if the transfer function changed
+    if (dirty) {
+        update();
+        dirty = false;
+    }
+
+    // Bind table
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/**
+ * Rebuilds the table from the current transfer function.
+ */
+void PreIntegrationNode::update() {
+
+    // Read transfer function and integrate it
+    std::vector<GLfloat> transferFunction;
+    TransferFunction::read(sourceUnit, transferFunction);
+    std::vector<GLfloat> table;
+    integrate(transferFunction, table);
+
+    // Upload table
+    const GLsizei n = transferFunction.size() / 4;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, n, n, 0, GL_RGBA, GL_FLOAT, &table[0]);
+}
+
+/**
+ * Does nothing, since the table is bound in `preVisit`.
+ *
+ * @param state State of the scene
+ */
+void PreIntegrationNode::visit(RapidGL::State& state) {
+    // empty
+}
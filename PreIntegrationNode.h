@@ -0,0 +1,69 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_PRE_INTEGRATION_NODE_H
+#define GANDER_PRE_INTEGRATION_NODE_H
+#include <string>
+#include <vector>
+#include <GL/glfw.h>
+#include <RapidGL/Node.h>
+#include <RapidGL/State.h>
+#include <RapidGL/TextureNode.h>
+
+
+/**
+ * Node building a pre-integrated lookup table from a one-dimensional transfer function.
+ *
+ * The transfer function is read back from a texture node above this one, either a 1D texture or the first
+ * row of a 2D texture, with opacity in alpha.  The table is a 2D texture bound to its own unit, where the
+ * texel at (s, t) holds the color and opacity of a slab whose front sample is `s` and whose back sample is
+ * `t`, with color premultiplied by opacity.  Opacities are for a slab one entry of the table deep, so a
+ * program should correct them for its own slab thickness like any other opacity.
+ *
+ * The table is only rebuilt when the texture node reports a change, or when `invalidate` is called after
+ * changing the texture some other way.
+ */
+class PreIntegrationNode : public RapidGL::Node, public RapidGL::NodeListener {
+public:
+// Methods
+    PreIntegrationNode(const std::string& textureId, GLint unit);
+    virtual ~PreIntegrationNode();
+    std::string getTextureId() const;
+    GLint getUnit() const;
+    static void integrate(const std::vector<GLfloat>& transferFunction, std::vector<GLfloat>& table);
+    void invalidate();
+    virtual void nodeChanged(RapidGL::Node* node);
+    virtual void preVisit(RapidGL::State& state);
+    virtual void visit(RapidGL::State& state);
+private:
+// Constants
+    static const GLfloat MAX_OPACITY;
+// Attributes
+    bool ready;
+    bool dirty;
+    const std::string textureId;
+    const GLint unit;
+    RapidGL::TextureNode* textureNode;
+    GLint sourceUnit;
+    GLuint texture;
+// Methods
+    PreIntegrationNode(const PreIntegrationNode&);
+    PreIntegrationNode& operator=(const PreIntegrationNode&);
+    void update();
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "PreIntegrationNodeUnmarshaller.h"
+
+/**
+ * Constructs a `PreIntegrationNodeUnmarshaller`.
+ */
+PreIntegrationNodeUnmarshaller::PreIntegrationNodeUnmarshaller() {
+    // empty
+}
+
+/**
+ * Destructs a `PreIntegrationNodeUnmarshaller`.
+ */
+PreIntegrationNodeUnmarshaller::~PreIntegrationNodeUnmarshaller() {
+    // empty
+}
+
+/**
+ * Determines the value of the _texture_ attribute in a map.
+ *
+ * @param attributes Map of XML attributes
+ * @return Value of the attribute in the map
+ * @throws std::runtime_error if texture is unspecified
+ */
+std::string PreIntegrationNodeUnmarshaller::getTexture(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "texture");
+    if (value.empty()) {
+        throw std::runtime_error("[PreIntegrationNodeUnmarshaller] Value of texture is unspecified!");
+    }
+    return value;
+}
+
+/**
+ * Determines the value of the _unit_ attribute in a map.
+ *
+ * @param attributes Map of XML attributes
+ * @return Value of the attribute in the map
+ * @throws std::runtime_error if unit is unspecified or negative
+ */
+GLint PreIntegrationNodeUnmarshaller::getUnit(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "unit");
+    if (value.empty()) {
+        throw std::runtime_error("[PreIntegrationNodeUnmarshaller] Unit is unspecified!");
+    }
+    const GLint unit = parseInt(value);
+    if (unit < 0) {
+        throw std::runtime_error("[PreIntegrationNodeUnmarshaller] Unit must not be negative!");
+    }
+    return unit;
+}
+
+/**
+ * Creates a `PreIntegrationNode` from a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to create node from
+ * @return Pointer to the new node
+ */
+RapidGL::Node* PreIntegrationNodeUnmarshaller::unmarshal(const std::map<std::string,std::string>& attributes) {
+    const std::string texture = getTexture(attributes);
+    const GLint unit = getUnit(attributes);
+    return new PreIntegrationNode(texture, unit);
+}
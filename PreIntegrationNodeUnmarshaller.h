@@ -0,0 +1,42 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_PRE_INTEGRATION_NODE_UNMARSHALLER_H
+#define GANDER_PRE_INTEGRATION_NODE_UNMARSHALLER_H
+#include <map>
+#include <string>
+#include <RapidGL/Node.h>
+#include <RapidGL/Unmarshaller.h>
+#include "PreIntegrationNode.h"
+
+
+/**
+ * Unmarshaller for a `PreIntegrationNode`.
+ */
+class PreIntegrationNodeUnmarshaller : public RapidGL::Unmarshaller {
+public:
+// Methods
+    PreIntegrationNodeUnmarshaller();
+    virtual ~PreIntegrationNodeUnmarshaller();
+    virtual RapidGL::Node* unmarshal(const std::map<std::string,std::string>& attributes);
+private:
+// Methods
+    static std::string getTexture(const std::map<std::string,std::string>& attributes);
+    static GLint getUnit(const std::map<std::string,std::string>& attributes);
+};
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Quantizer.h"
+
+/**
+ * Constructs a `Quantizer`.
+ *
+ * @param file Volume whose voxels will be converted
+ * @param storage Storage to convert voxels to
+ */
+Quantizer::Quantizer(const VolumeFile& file, const Storage storage) :
+        file(file),
+        storage(storage),
+        offset(0),
+        scale(1),
+        maxError(0),
+        sumOfSquaredErrors(0),
+        numberOfVoxels(0),
+        in(NULL),
+        count(0),
+        out(NULL) {
+    // empty
+}
+
+/**
+ * Destructs a `Quantizer`.
+ */
+Quantizer::~Quantizer() {
+    // empty
+}
+
+/**
+ * Finds the smallest and largest value in a float volume, so they can be mapped to 0 and 1.
+ *
+ * Reads the whole volume.  Values that aren't finite are ignored.
+ *
+ * @param workerPool Workers to split voxels between
+ */
+void Quantizer::findRange(WorkerPool& workerPool) {
+
+    // Skip unless values need scaling
+    if (file.getType() != VolumeFile::FLOAT) {
+        return;
+    }
+
+    // Find range of each worker's share
+    in = file.getData();
+    count = file.getSizeOfLayer() / file.getBytesPerVoxel() * file.getSize(2);
+    parts.assign(workerPool.getNumberOfWorkers(), Part());
+    workerPool.run(this, &Quantizer::findRanges);
+
+    // Combine them
+    float min = 0;
+    float max = 0;
+    bool found = false;
+    for (std::vector<Part>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+        if (it->min > it->max) {
+            continue;
+        }
+        min = found ? std::min(min, it->min) : it->min;
+        max = found ? std::max(max, it->max) : it->max;
+        found = true;
+    }
+    offset = min;
+    scale = (max > min) ? (1 / (max - min)) : 0;
+}
+
+/**
+ * Finds the range of one worker's share of a float volume.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void Quantizer::findRanges(const int worker, const int numberOfWorkers) {
+
+    Part& part = parts[worker];
+    part.min = 1;
+    part.max = 0;
+
+    const size_t begin = (count * worker) / numberOfWorkers;
+    const size_t end = (count * (worker + 1)) / numberOfWorkers;
+    const bool swapped = file.isSwapped();
+    bool found = false;
+    for (size_t i = begin; i < end; ++i) {
+        unsigned char bytes[4];
+        memcpy(bytes, in + (i * 4), 4);
+        if (swapped) {
+            std::swap(bytes[0], bytes[3]);
+            std::swap(bytes[1], bytes[2]);
+        }
+        float value;
+        memcpy(&value, bytes, 4);
+        if ((value - value) != 0) {
+            continue;
+        }
+        part.min = found ? std::min(part.min, value) : value;
+        part.max = found ? std::max(part.max, value) : value;
+        found = true;
+    }
+}
+
+/**
+ * Converts a half-precision float to a float.
+ *
+ * @param half Bits of half-precision float
+ * @return Value of half-precision float
+ */
+float Quantizer::fromHalf(const unsigned short half) {
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    float value;
+    if (exponent == 0) {
+        value = (float) std::ldexp((double) mantissa, -24);
+    } else if (exponent == 31) {
+        value = HUGE_VALF;
+    } else {
+        value = (float) std::ldexp((double) (mantissa | 0x400), exponent - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * Returns the number of bytes in each converted voxel.
+ */
+int Quantizer::getBytesPerVoxel() const {
+    if (isCopy()) {
+        return file.getBytesPerVoxel();
+    }
+    switch (storage) {
+    case R16:
+    case R16F:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Returns the internal format to make the texture with.
+ */
+GLenum Quantizer::getFormat() const {
+    switch (storage) {
+    case R16:
+        return GL_R16;
+    case R16F:
+        return GL_R16F;
+    case COMPRESSED:
+        return GL_COMPRESSED_RED;
+    default:
+        return GL_R8;
+    }
+}
+
+/**
+ * Returns the largest difference between a converted value and its exact normalized value so far.
+ */
+double Quantizer::getMaxError() const {
+    return maxError;
+}
+
+/**
+ * Returns the root mean square difference between converted values and their exact normalized values so far.
+ */
+double Quantizer::getRmsError() const {
+    return (numberOfVoxels > 0) ? std::sqrt(sumOfSquaredErrors / numberOfVoxels) : 0;
+}
+
+/**
+ * Returns the storage that holds a type of voxel without losing precision, or without wasting much space.
+ *
+ * @param type Type of voxel
+ * @return Storage to use by default
+ */
+Quantizer::Storage Quantizer::getStorage(const VolumeFile::Type type) {
+    switch (type) {
+    case VolumeFile::UNSIGNED_SHORT:
+        return R16;
+    case VolumeFile::FLOAT:
+        return R16F;
+    default:
+        return R8;
+    }
+}
+
+/**
+ * Returns the type of the converted voxels to give OpenGL.
+ */
+GLenum Quantizer::getType() const {
+    if (isCopy()) {
+        return (file.getType() == VolumeFile::UNSIGNED_SHORT) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    }
+    switch (storage) {
+    case R16:
+        return GL_UNSIGNED_SHORT;
+    case R16F:
+        return GL_HALF_FLOAT;
+    default:
+        return GL_UNSIGNED_BYTE;
+    }
+}
+
+/**
+ * Checks if voxels can be copied as they are, leaving any byte swapping to OpenGL.
+ *
+ * Compressed storage is compressed by the driver from 8-bit voxels.
+ */
+bool Quantizer::isCopy() const {
+    switch (file.getType()) {
+    case VolumeFile::UNSIGNED_BYTE:
+        return (storage == R8) || (storage == COMPRESSED);
+    case VolumeFile::UNSIGNED_SHORT:
+        return storage == R16;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Reads voxels from the file and normalizes them to [0, 1].
+ *
+ * Float voxels use the range found by `findRange`.  Several threads may normalize at once.
+ *
+ * @param in First voxel to read
+ * @param count Number of voxels to read
+ * @param values Array to store normalized values in
+ */
+void Quantizer::normalize(const unsigned char* in, const size_t count, float* const values) const {
+    const bool swapped = file.isSwapped();
+    switch (file.getType()) {
+    case VolumeFile::UNSIGNED_SHORT:
+        for (size_t i = 0; i < count; ++i, in += 2) {
+            const unsigned char bytes[2] = { in[swapped ? 1 : 0], in[swapped ? 0 : 1] };
+            unsigned short value;
+            memcpy(&value, bytes, 2);
+            values[i] = value / 65535.0f;
+        }
+        break;
+    case VolumeFile::FLOAT:
+        for (size_t i = 0; i < count; ++i, in += 4) {
+            unsigned char bytes[4];
+            memcpy(bytes, in, 4);
+            if (swapped) {
+                std::swap(bytes[0], bytes[3]);
+                std::swap(bytes[1], bytes[2]);
+            }
+            float value;
+            memcpy(&value, bytes, 4);
+            value = (value - offset) * scale;
+            values[i] = (value > 0) ? ((value < 1) ? value : 1) : 0;
+        }
+        break;
+    default:
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = in[i] / 255.0f;
+        }
+        break;
+    }
+}
+
+/**
+ * Converts voxels to the storage of the texture.
+ *
+ * @param in First voxel to convert
+ * @param count Number of voxels to convert
+ * @param out Memory to store converted voxels in, with room for `getBytesPerVoxel()` bytes per voxel
+ * @param workerPool Workers to split voxels between
+ */
+void Quantizer::quantize(const unsigned char* const in,
+                         const size_t count,
+                         GLvoid* const out,
+                         WorkerPool& workerPool) {
+
+    // Convert each worker's share
+    this->in = in;
+    this->count = count;
+    this->out = out;
+    parts.assign(workerPool.getNumberOfWorkers(), Part());
+    workerPool.run(this, &Quantizer::quantizeParts);
+
+    // Add up their errors
+    for (std::vector<Part>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+        maxError = std::max(maxError, it->maxError);
+        sumOfSquaredErrors += it->sumOfSquaredErrors;
+    }
+    numberOfVoxels += count;
+}
+
+/**
+ * Converts one worker's share of voxels, a chunk at a time.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void Quantizer::quantizeParts(const int worker, const int numberOfWorkers) {
+
+    Part& part = parts[worker];
+    part.maxError = 0;
+    part.sumOfSquaredErrors = 0;
+
+    const size_t begin = (count * worker) / numberOfWorkers;
+    const size_t end = (count * (worker + 1)) / numberOfWorkers;
+    const int bytesIn = file.getBytesPerVoxel();
+    float values[SIZE_OF_CHUNK];
+    for (size_t first = begin; first < end; first += SIZE_OF_CHUNK) {
+
+        // Normalize chunk
+        const size_t n = std::min((size_t) SIZE_OF_CHUNK, end - first);
+        normalize(in + (first * bytesIn), n, values);
+
+        // Store it, noting how far off each stored value is
+        for (size_t i = 0; i < n; ++i) {
+            const float value = values[i];
+            double error;
+            switch (storage) {
+            case R16: {
+                const unsigned short q = (unsigned short) ((value * 65535) + 0.5f);
+                ((unsigned short*) out)[first + i] = q;
+                error = (q / 65535.0) - value;
+                break;
+            }
+            case R16F: {
+                const unsigned short q = toHalf(value);
+                ((unsigned short*) out)[first + i] = q;
+                error = fromHalf(q) - value;
+                break;
+            }
+            default: {
+                const unsigned char q = (unsigned char) ((value * 255) + 0.5f);
+                ((unsigned char*) out)[first + i] = q;
+                error = (q / 255.0) - value;
+                break;
+            }
+            }
+            part.maxError = std::max(part.maxError, std::fabs(error));
+            part.sumOfSquaredErrors += error * error;
+        }
+    }
+}
+
+/**
+ * Converts a float to a half-precision float, rounding to nearest.
+ *
+ * @param value Value to convert, where values too large become infinity
+ * @return Bits of half-precision float
+ */
+unsigned short Quantizer::toHalf(const float value) {
+
+    unsigned int bits;
+    memcpy(&bits, &value, 4);
+    const unsigned int sign = (bits >> 16) & 0x8000;
+    const int exponent = ((int) ((bits >> 23) & 0xff)) - 127 + 15;
+    unsigned int mantissa = bits & 0x7fffff;
+
+    // Too small even for a subnormal
+    if (exponent < -10) {
+        return sign;
+    }
+
+    // Subnormal, shifting in the implicit bit
+    if (exponent <= 0) {
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        const unsigned int half = (mantissa + (1 << (shift - 1))) >> shift;
+        return sign | half;
+    }
+
+    // Too large
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+
+    // Normal, where rounding may carry into the exponent
+    const unsigned int half = (exponent << 10) | (mantissa >> 13);
+    return sign | (half + ((mantissa >> 12) & 1));
+}
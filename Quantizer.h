@@ -0,0 +1,85 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_QUANTIZER_H
+#define GANDER_QUANTIZER_H
+#include <cstddef>
+#include <vector>
+#include <GL/glfw.h>
+#include "VolumeFile.h"
+#include "WorkerPool.h"
+
+
+/**
+ * Converter from the voxels of a volume file to the storage of a 3D texture.
+ *
+ * Every storage holds values normalized to [0, 1].  Integer voxels keep their usual normalization, while
+ * float voxels are scaled by the range found with `findRange`.  Voxels are split between workers in
+ * contiguous runs, and the error of each converted voxel is tracked so it can be reported afterwards.
+ */
+class Quantizer {
+public:
+// Types
+    enum Storage {
+        R8,
+        R16,
+        R16F,
+        COMPRESSED
+    };
+// Methods
+    Quantizer(const VolumeFile& file, Storage storage);
+    virtual ~Quantizer();
+    void findRange(WorkerPool& workerPool);
+    static float fromHalf(unsigned short half);
+    int getBytesPerVoxel() const;
+    GLenum getFormat() const;
+    double getMaxError() const;
+    double getRmsError() const;
+    static Storage getStorage(VolumeFile::Type type);
+    GLenum getType() const;
+    bool isCopy() const;
+    void normalize(const unsigned char* in, size_t count, float* values) const;
+    void quantize(const unsigned char* in, size_t count, GLvoid* out, WorkerPool& workerPool);
+    static unsigned short toHalf(float value);
+private:
+// Constants
+    static const int SIZE_OF_CHUNK = 4096;
+// Types
+    struct Part {
+        float min;
+        float max;
+        double maxError;
+        double sumOfSquaredErrors;
+    };
+// Attributes
+    const VolumeFile& file;
+    const Storage storage;
+    float offset;
+    float scale;
+    double maxError;
+    double sumOfSquaredErrors;
+    size_t numberOfVoxels;
+    std::vector<Part> parts;
+    const unsigned char* in;
+    size_t count;
+    GLvoid* out;
+// Methods
+    void findRanges(int worker, int numberOfWorkers);
+    void quantizeParts(int worker, int numberOfWorkers);
+};
+
+#endif
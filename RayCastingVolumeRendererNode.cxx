@@ -0,0 +1,290 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <stdexcept>
+#include <gloop/BufferTarget.hxx>
+#include <m3d/Vec4.h>
+#include <RapidGL/AttributeNode.h>
+#include <RapidGL/ProgramNode.h>
+#include <RapidGL/TextureNode.h>
+#include <RapidGL/UseNode.h>
+#include "RayCastingVolumeRendererNode.h"
+
+// Triangles of the unit cube a volume occupies in model space, wound counter-clockwise from outside
+const GLfloat RayCastingVolumeRendererNode::CUBE[][3] = {
+    // +X
+    { +0.5, -0.5, -0.5 },
+    { +0.5, +0.5, -0.5 },
+    { +0.5, +0.5, +0.5 },
+    { +0.5, -0.5, -0.5 },
+    { +0.5, +0.5, +0.5 },
+    { +0.5, -0.5, +0.5 },
+    // -X
+    { -0.5, -0.5, +0.5 },
+    { -0.5, +0.5, +0.5 },
+    { -0.5, +0.5, -0.5 },
+    { -0.5, -0.5, +0.5 },
+    { -0.5, +0.5, -0.5 },
+    { -0.5, -0.5, -0.5 },
+    // +Y
+    { -0.5, +0.5, -0.5 },
+    { -0.5, +0.5, +0.5 },
+    { +0.5, +0.5, +0.5 },
+    { -0.5, +0.5, -0.5 },
+    { +0.5, +0.5, +0.5 },
+    { +0.5, +0.5, -0.5 },
+    // -Y
+    { +0.5, -0.5, -0.5 },
+    { +0.5, -0.5, +0.5 },
+    { -0.5, -0.5, +0.5 },
+    { +0.5, -0.5, -0.5 },
+    { -0.5, -0.5, +0.5 },
+    { -0.5, -0.5, -0.5 },
+    // +Z
+    { -0.5, -0.5, +0.5 },
+    { +0.5, -0.5, +0.5 },
+    { +0.5, +0.5, +0.5 },
+    { -0.5, -0.5, +0.5 },
+    { +0.5, +0.5, +0.5 },
+    { -0.5, +0.5, +0.5 },
+    // -Z
+    { -0.5, +0.5, -0.5 },
+    { +0.5, +0.5, -0.5 },
+    { +0.5, -0.5, -0.5 },
+    { -0.5, +0.5, -0.5 },
+    { +0.5, -0.5, -0.5 },
+    { -0.5, -0.5, -0.5 }
+};
+
+/**
+ * Constructs a `RayCastingVolumeRendererNode`.
+ *
+ * @param uniformName Name of sampler uniform to set to each volume's texture unit
+ * @param threshold Opacity at which rays should be terminated
+ * @throws std::invalid_argument if name of uniform is empty or threshold is not in (0, 1]
+ */
+RayCastingVolumeRendererNode::RayCastingVolumeRendererNode(const std::string& uniformName,
+                                                           const GLfloat threshold) :
+        ready(false),
+        enabled(true),
+        uniformName(uniformName),
+        threshold(threshold),
+        vao(Gloop::VertexArrayObject::generate()),
+        vbo(Gloop::BufferObject::generate()),
+        uniformLocation(-1),
+        thresholdLocation(-1),
+        modelViewProjectionLocation(-1),
+        cameraPositionLocation(-1) {
+    if (uniformName.empty()) {
+        throw std::invalid_argument("[RayCastingVolumeRendererNode] Uniform name is empty!");
+    }
+    if ((threshold <= 0) || (threshold > 1)) {
+        throw std::invalid_argument("[RayCastingVolumeRendererNode] Threshold must be in (0, 1]!");
+    }
+}
+
+/**
+ * Destructs a `RayCastingVolumeRendererNode`.
+ */
+RayCastingVolumeRendererNode::~RayCastingVolumeRendererNode() {
+    vao.dispose();
+    vbo.dispose();
+}
+
+/**
+ * Finds a uniform in a program.
+ *
+ * @param program Program to look in
+ * @param name Name of uniform
+ * @return Location of uniform
+ * @throws std::runtime_error if uniform is not in program
+ */
+GLint RayCastingVolumeRendererNode::findUniformLocation(const Gloop::Program& program, const std::string& name) {
+    const GLint location = program.uniformLocation(name);
+    if (location < 0) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find uniform in program!");
+    }
+    return location;
+}
+
+/**
+ * Checks if volumes are drawn when the node is visited.
+ */
+bool RayCastingVolumeRendererNode::isEnabled() const {
+    return enabled;
+}
+
+/**
+ * Checks if one proxy is farther from the viewer than another.
+ *
+ * @param p1 First proxy
+ * @param p2 Second proxy
+ * @return `true` if the center of the first proxy is farther away than the center of the second
+ */
+bool RayCastingVolumeRendererNode::isFarther(const Proxy& p1, const Proxy& p2) {
+    return p1.modelViewMatrix[3].z < p2.modelViewMatrix[3].z;
+}
+
+void RayCastingVolumeRendererNode::preVisit(RapidGL::State& state) {
+
+    // Skip if already ready
+    if (ready) {
+        return;
+    }
+
+    // Find `UseNode`
+    RapidGL::UseNode* const useNode = RapidGL::findAncestor<RapidGL::UseNode>(this);
+    if (useNode == NULL) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find use node!");
+    }
+
+    // Find `ProgramNode`
+    RapidGL::ProgramNode* const programNode = useNode->getProgramNode();
+    if (programNode == NULL) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Use node hasn't found program node yet!");
+    }
+
+    // Find volume nodes
+    volumeNodes = SceneUtility::findDescendants<VolumeNode>(this);
+    if (volumeNodes.empty()) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find any volume nodes!");
+    }
+
+    // Store texture units
+    for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+        VolumeNode* const volumeNode = *it;
+        if (volumeNode->getBrickCache() != NULL) {
+            throw std::runtime_error("[RayCastingVolumeRendererNode] Volumes streamed in bricks are not supported!");
+        } else if (volumeNode->getUnit() >= 0) {
+            const Gloop::TextureUnit textureUnit = Gloop::TextureUnit::fromOrdinal(volumeNode->getUnit());
+            textureUnitsByVolumeNode.insert(std::make_pair(volumeNode, textureUnit));
+            continue;
+        }
+        const std::string textureId = volumeNode->getTextureId();
+        RapidGL::TextureNode* textureNode = RapidGL::findAncestor<RapidGL::TextureNode>(this, textureId);
+        if (textureNode == NULL) {
+            throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find texture node!");
+        }
+        textureUnitsByVolumeNode.insert(std::make_pair(volumeNode, textureNode->getTextureUnit()));
+    }
+
+    // Find uniform locations
+    const Gloop::Program program = programNode->getProgram();
+    uniformLocation = findUniformLocation(program, uniformName);
+    thresholdLocation = findUniformLocation(program, "Threshold");
+    modelViewProjectionLocation = findUniformLocation(program, "ModelViewProjection");
+    cameraPositionLocation = findUniformLocation(program, "CameraPosition");
+
+    // Find position attribute
+    std::string positionName;
+    const RapidGL::Node::node_range_t programNodeChildren = programNode->getChildren();
+    for (RapidGL::Node::node_iterator_t it = programNodeChildren.begin; it != programNodeChildren.end; ++it) {
+        const RapidGL::AttributeNode* attributeNode = dynamic_cast<RapidGL::AttributeNode*>(*it);
+        if ((attributeNode != NULL) && (attributeNode->getUsage() == RapidGL::AttributeNode::POSITION)) {
+            positionName = attributeNode->getName();
+        }
+    }
+    if (positionName.empty()) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find attribute for position!");
+    }
+    const GLint pointLocation = program.attribLocation(positionName);
+    if (pointLocation < 0) {
+        throw std::runtime_error("[RayCastingVolumeRendererNode] Could not find location for position attribute!");
+    }
+
+    // Load the box and set up its attribute
+    const Gloop::BufferTarget arrayBuffer = Gloop::BufferTarget::arrayBuffer();
+    vao.bind();
+    arrayBuffer.bind(vbo);
+    arrayBuffer.data(sizeof(CUBE), CUBE, GL_STATIC_DRAW);
+    vao.enableVertexAttribArray(pointLocation);
+    vao.vertexAttribPointer(Gloop::VertexAttribPointer()
+            .index(pointLocation)
+            .size(3)
+            .type(GL_FLOAT)
+            .stride(sizeof(CUBE[0]))
+            .offset(0));
+    arrayBuffer.unbind(vbo);
+    vao.unbind();
+
+    // Now ready
+    ready = true;
+}
+
+/**
+ * Changes whether volumes are drawn when the node is visited.
+ *
+ * @param enabled `true` to draw volumes
+ */
+void RayCastingVolumeRendererNode::setEnabled(const bool enabled) {
+    this->enabled = enabled;
+}
+
+void RayCastingVolumeRendererNode::visit(RapidGL::State& state) {
+
+    // Skip if turned off
+    if (!enabled) {
+        return;
+    }
+
+    // Put volumes in back-to-front order
+    const M3d::Mat4 viewMatrix = state.getViewMatrix();
+    const M3d::Mat4 projectionMatrix = state.getProjectionMatrix();
+    proxies.clear();
+    for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+        Proxy proxy;
+        proxy.unit = textureUnitsByVolumeNode.find(*it)->second.toOrdinal();
+        proxy.modelViewMatrix = viewMatrix * SceneUtility::getModelMatrix(*it);
+        proxies.push_back(proxy);
+    }
+    std::sort(proxies.begin(), proxies.end(), &isFarther);
+
+    // Draw back faces so boxes still show up with the camera inside them
+    const GLboolean culling = glIsEnabled(GL_CULL_FACE);
+    GLint cullFaceMode;
+    glGetIntegerv(GL_CULL_FACE_MODE, &cullFaceMode);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+
+    // Draw each box
+    vao.bind();
+    glUniform1f(thresholdLocation, threshold);
+    for (std::vector<Proxy>::const_iterator it = proxies.begin(); it != proxies.end(); ++it) {
+
+        // Find camera in texture coordinates
+        const M3d::Vec4 camera = inverse(it->modelViewMatrix) * M3d::Vec4(0, 0, 0, 1);
+
+        // Set uniforms
+        GLfloat array[16];
+        SceneUtility::toArray(projectionMatrix * it->modelViewMatrix, array);
+        glUniformMatrix4fv(modelViewProjectionLocation, 1, GL_FALSE, array);
+        glUniform3f(cameraPositionLocation, camera.x + 0.5, camera.y + 0.5, camera.z + 0.5);
+        glUniform1i(uniformLocation, it->unit);
+
+        // Draw
+        glDrawArrays(GL_TRIANGLES, 0, NUMBER_OF_VERTICES);
+    }
+    vao.unbind();
+
+    // Restore culling
+    glCullFace(cullFaceMode);
+    if (!culling) {
+        glDisable(GL_CULL_FACE);
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_RAY_CASTING_VOLUME_RENDERER_NODE_H
+#define GANDER_RAY_CASTING_VOLUME_RENDERER_NODE_H
+#include <map>
+#include <string>
+#include <vector>
+#include <gloop/BufferObject.hxx>
+#include <gloop/Program.hxx>
+#include <gloop/TextureUnit.hxx>
+#include <gloop/VertexArrayObject.hxx>
+#include <m3d/Mat4.h>
+#include <RapidGL/Node.h>
+#include <RapidGL/State.h>
+#include "SceneUtility.h"
+#include "VolumeNode.h"
+
+
+/**
+ * Node rendering volumes by casting rays through them in a fragment shader.
+ *
+ * Each volume is drawn as a single box, with front faces culled so the box still covers the screen when the
+ * camera is inside it.  The program in use is expected to march a ray from the camera through the volume,
+ * stopping once the accumulated opacity reaches a threshold.  It gets the following uniforms:
+ *
+ * - `ModelViewProjection`, the matrix taking the box's position attribute to clip space
+ * - `CameraPosition`, the camera in the volume's texture coordinates
+ * - `Threshold`, the opacity at which rays should be terminated early
+ *
+ * The box's position attribute runs from -0.5 to 0.5, so adding 0.5 gives texture coordinates.
+ */
+class RayCastingVolumeRendererNode : public RapidGL::Node {
+public:
+// Methods
+    RayCastingVolumeRendererNode(const std::string& uniformName, GLfloat threshold);
+    virtual ~RayCastingVolumeRendererNode();
+    bool isEnabled() const;
+    virtual void preVisit(RapidGL::State& state);
+    void setEnabled(bool enabled);
+    virtual void visit(RapidGL::State& state);
+private:
+// Constants
+    static const int NUMBER_OF_VERTICES = 36;
+    static const GLfloat CUBE[NUMBER_OF_VERTICES][3];
+// Types
+    struct Proxy {
+        GLint unit;
+        M3d::Mat4 modelViewMatrix;
+    };
+// Attributes
+    bool ready;
+    bool enabled;
+    const std::string uniformName;
+    const GLfloat threshold;
+    const Gloop::VertexArrayObject vao;
+    const Gloop::BufferObject vbo;
+    std::vector<VolumeNode*> volumeNodes;
+    std::map<VolumeNode*,Gloop::TextureUnit> textureUnitsByVolumeNode;
+    GLint uniformLocation;
+    GLint thresholdLocation;
+    GLint modelViewProjectionLocation;
+    GLint cameraPositionLocation;
+    std::vector<Proxy> proxies;
+// Methods
+    static GLint findUniformLocation(const Gloop::Program& program, const std::string& name);
+    static bool isFarther(const Proxy& p1, const Proxy& p2);
+};
+
+#endif
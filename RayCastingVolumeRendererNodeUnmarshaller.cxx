@@ -0,0 +1,90 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include "RayCastingVolumeRendererNodeUnmarshaller.h"
+
+// Opacity rays stop at if not specified
+const GLfloat RayCastingVolumeRendererNodeUnmarshaller::DEFAULT_THRESHOLD = 0.95f;
+
+/**
+ * Constructs a `RayCastingVolumeRendererNodeUnmarshaller`.
+ */
+RayCastingVolumeRendererNodeUnmarshaller::RayCastingVolumeRendererNodeUnmarshaller() {
+    // empty
+}
+
+/**
+ * Destructs a `RayCastingVolumeRendererNodeUnmarshaller`.
+ */
+RayCastingVolumeRendererNodeUnmarshaller::~RayCastingVolumeRendererNodeUnmarshaller() {
+    // empty
+}
+
+/**
+ * Determines the value of the _threshold_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Value of the attribute in the map
+ * @throws std::runtime_error if threshold is not in (0, 1]
+ */
+GLfloat RayCastingVolumeRendererNodeUnmarshaller::getThreshold(const std::map<std::string,std::string>& map) {
+
+    // Get value
+    const std::string value = findValue(map, "threshold");
+
+    // If nothing specified, just return the default
+    if (value.empty()) {
+        return DEFAULT_THRESHOLD;
+    }
+
+    // Parse value
+    const GLfloat threshold = parseFloat(value);
+    if ((threshold <= 0) || (threshold > 1)) {
+        throw std::runtime_error("[RayCastingVolumeRendererNodeUnmarshaller] Threshold must be in (0, 1]!");
+    }
+
+    // Return it
+    return threshold;
+}
+
+/**
+ * Determines the value of the _uniform_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Value of the attribute in the map
+ * @throws std::runtime_error if uniform is unspecified
+ */
+std::string RayCastingVolumeRendererNodeUnmarshaller::getUniform(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "uniform");
+    if (value.empty()) {
+        throw std::runtime_error("[RayCastingVolumeRendererNodeUnmarshaller] Value of uniform is unspecified!");
+    }
+    return value;
+}
+
+/**
+ * Creates a `RayCastingVolumeRendererNode` from a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to create node from
+ * @return Pointer to the new node
+ */
+RapidGL::Node* RayCastingVolumeRendererNodeUnmarshaller::unmarshal(const std::map<std::string,std::string>& attributes) {
+    const std::string uniform = getUniform(attributes);
+    const GLfloat threshold = getThreshold(attributes);
+    return new RayCastingVolumeRendererNode(uniform, threshold);
+}
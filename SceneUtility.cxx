@@ -0,0 +1,67 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stack>
+#include <RapidGL/State.h>
+#include <RapidGL/TransformNode.h>
+#include "SceneUtility.h"
+
+/**
+ * Computes the model matrix at a node.
+ *
+ * @param node Node to compute model matrix for
+ * @return Model matrix at the node
+ */
+M3d::Mat4 SceneUtility::getModelMatrix(const RapidGL::Node* node) {
+
+    // Find transform nodes
+    std::stack<RapidGL::TransformNode*> transformNodes;
+    RapidGL::Node* parent = node->getParent();
+    while (parent != NULL) {
+        RapidGL::TransformNode* const transformNode = dynamic_cast<RapidGL::TransformNode*>(parent);
+        if (transformNode != NULL) {
+            transformNodes.push(transformNode);
+        }
+        parent = parent->getParent();
+    }
+
+    // Accumulate matrices
+    RapidGL::State state;
+    while (!transformNodes.empty()) {
+        RapidGL::TransformNode* const transformNode = transformNodes.top();
+        transformNode->visit(state);
+        transformNodes.pop();
+    }
+
+    // Return
+    return state.getModelMatrix();
+}
+
+/**
+ * Converts a matrix to an array in column-major order.
+ *
+ * @param matrix Matrix to convert
+ * @param array Array to store elements in
+ */
+void SceneUtility::toArray(const M3d::Mat4& matrix, GLfloat array[16]) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            array[(i * 4) + j] = matrix[i][j];
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_SCENE_UTILITY_H
+#define GANDER_SCENE_UTILITY_H
+#include <queue>
+#include <stdexcept>
+#include <vector>
+#include <GL/glfw.h>
+#include <m3d/Mat4.h>
+#include <RapidGL/Node.h>
+
+
+/**
+ * Helpers for walking a scene shared by the volume renderers and the program.
+ */
+class SceneUtility {
+public:
+// Methods
+    template<typename T> static std::vector<T*> findDescendants(RapidGL::Node* node);
+    static M3d::Mat4 getModelMatrix(const RapidGL::Node* node);
+    static void toArray(const M3d::Mat4& matrix, GLfloat array[16]);
+};
+
+/**
+ * Finds all the descendants of a node of a particular type.
+ *
+ * @param rootNode Node to search from
+ * @return Vector of the descendants of the specified type
+ * @throw std::invalid_argument if root node is `NULL`
+ */
+template<typename T>
+std::vector<T*> SceneUtility::findDescendants(RapidGL::Node* const rootNode) {
+
+    if (rootNode == NULL) {
+        throw std::invalid_argument("[SceneUtility] Root node is NULL!");
+    }
+
+    std::vector<T*> ts;
+
+    std::queue<RapidGL::Node*> q;
+    q.push(rootNode);
+
+    while (!q.empty()) {
+        RapidGL::Node* const node = q.front();
+        T* const t = dynamic_cast<T*>(node);
+        if (t != NULL) {
+            ts.push_back(t);
+        }
+        RapidGL::addToQueue(q, node->getChildren());
+        q.pop();
+    }
+
+    return ts;
+}
+
+#endif
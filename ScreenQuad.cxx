@@ -0,0 +1,151 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ScreenQuad.h"
+
+// Covers the viewport with a strip of two triangles made from the vertex index alone
+const char* ScreenQuad::VERTEX_SHADER =
+        "#version 150\n"
+        "void main() {\n"
+        "    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));\n"
+        "    gl_Position = vec4((corner * 2.0) - 1.0, -1.0, 1.0);\n"
+        "}\n";
+
+/**
+ * Constructs a `ScreenQuad` without making its program yet.
+ *
+ * @param fragmentShader Code of fragment shader, which must write to `FragColor` and outlive the quad
+ * @throws std::invalid_argument if fragment shader is `NULL`
+ */
+ScreenQuad::ScreenQuad(const char* fragmentShader) :
+        fragmentShader(fragmentShader),
+        program(0),
+        vao(0),
+        previousProgram(0),
+        previousVao(0) {
+    if (fragmentShader == NULL) {
+        throw std::invalid_argument("[ScreenQuad] Fragment shader is NULL!");
+    }
+}
+
+/**
+ * Deletes the program.
+ */
+ScreenQuad::~ScreenQuad() {
+    if (program != 0) {
+        glDeleteProgram(program);
+    }
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+    }
+}
+
+/**
+ * Compiles a shader.
+ *
+ * @param type Kind of shader, e.g. `GL_VERTEX_SHADER`
+ * @param source Code of shader
+ * @return Handle to compiled shader
+ * @throws std::runtime_error if the shader could not be compiled
+ */
+GLuint ScreenQuad::compile(const GLenum type, const char* source) {
+
+    // Compile
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    // Check it worked
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint length;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(length + 1, '\0');
+        glGetShaderInfoLog(shader, length, NULL, &log[0]);
+        glDeleteShader(shader);
+        throw std::runtime_error("[ScreenQuad] Could not compile shader!\n" + std::string(&log[0]));
+    }
+    return shader;
+}
+
+/**
+ * Draws the quad, then puts back the program and vertex array bound before `use`.
+ */
+void ScreenQuad::draw() {
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(previousVao);
+    glUseProgram(previousProgram);
+}
+
+/**
+ * Finds a uniform in the program.
+ *
+ * @param name Name of uniform
+ * @return Location of uniform, or -1 if the program doesn't have it or hasn't been used yet
+ */
+GLint ScreenQuad::getUniformLocation(const char* name) const {
+    return (program == 0) ? -1 : glGetUniformLocation(program, name);
+}
+
+/**
+ * Links the program.
+ *
+ * @throws std::runtime_error if the program could not be linked
+ */
+void ScreenQuad::link() {
+
+    // Link
+    const GLuint vertexShader = compile(GL_VERTEX_SHADER, VERTEX_SHADER);
+    const GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, this->fragmentShader);
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindFragDataLocation(program, 0, "FragColor");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    // Check it worked
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        program = 0;
+        throw std::runtime_error("[ScreenQuad] Could not link program!");
+    }
+
+    // Core profile needs a vertex array bound to draw, even one without any attributes
+    glGenVertexArrays(1, &vao);
+}
+
+/**
+ * Binds the program and vertex array so uniforms can be set before drawing.
+ */
+void ScreenQuad::use() {
+    if (program == 0) {
+        link();
+    }
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    glUseProgram(program);
+    glBindVertexArray(vao);
+}
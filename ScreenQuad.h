@@ -0,0 +1,54 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_SCREEN_QUAD_H
+#define GANDER_SCREEN_QUAD_H
+#include <GL/glfw.h>
+
+
+/**
+ * Quad covering the viewport, drawn with its own fragment shader.
+ *
+ * The quad lies on the near plane and has no attributes, so it needs no buffers.  Its program is linked the
+ * first time it's used, and `use` and `draw` put back whatever program and vertex array were bound before, so
+ * it can be drawn in the middle of another node's rendering.
+ */
+class ScreenQuad {
+public:
+// Methods
+    ScreenQuad(const char* fragmentShader);
+    virtual ~ScreenQuad();
+    void draw();
+    GLint getUniformLocation(const char* name) const;
+    void use();
+private:
+// Constants
+    static const char* VERTEX_SHADER;
+// Attributes
+    const char* const fragmentShader;
+    GLuint program;
+    GLuint vao;
+    GLint previousProgram;
+    GLint previousVao;
+// Methods
+    ScreenQuad(const ScreenQuad&);
+    ScreenQuad& operator=(const ScreenQuad&);
+    static GLuint compile(GLenum type, const char* source);
+    void link();
+};
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <m3d/Quat.h>
+#include <m3d/Vec3.h>
+#include <Poco/Timestamp.h>
+#include "SliceBenchmark.h"
+
+// Largest difference allowed between a kernel's crossing and the reference's, and how close to a corner counts
+const double SliceBenchmark::TOLERANCE = 1e-4;
+
+// Corners of the unit cube, in the same order the renderer uses
+const M3d::Vec4 SliceBenchmark::CORNERS[] = {
+    M3d::Vec4(-0.5, -0.5, -0.5, 1.0),
+    M3d::Vec4(-0.5, -0.5, +0.5, 1.0),
+    M3d::Vec4(-0.5, +0.5, -0.5, 1.0),
+    M3d::Vec4(-0.5, +0.5, +0.5, 1.0),
+    M3d::Vec4(+0.5, -0.5, -0.5, 1.0),
+    M3d::Vec4(+0.5, -0.5, +0.5, 1.0),
+    M3d::Vec4(+0.5, +0.5, -0.5, 1.0),
+    M3d::Vec4(+0.5, +0.5, +0.5, 1.0)
+};
+
+// Edges of the unit cube, as pairs of indices into `CORNERS`
+const int SliceBenchmark::EDGES[][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+/**
+ * Checks that a kernel found the same crossings as the reference.
+ *
+ * @param views Views the crossings were found for
+ * @param expected Crossings found by the reference
+ * @param actual Crossings found by the kernel
+ * @param grazing Number of slices that disagree only where they pass within a hair of a corner
+ * @return `true` if every other crossing agrees
+ */
+bool SliceBenchmark::check(const std::vector<M3d::Mat4>& views,
+                           const std::vector<Crossings>& expected,
+                           const std::vector<Crossings>& actual,
+                           int& grazing) {
+    grazing = 0;
+    for (size_t v = 0; v < views.size(); ++v) {
+        M3d::Vec4 points[8];
+        transform(views[v], points);
+        double z, dz;
+        findSpacing(points, z, dz);
+        for (int i = 0; i < NUMBER_OF_SLICES; ++i) {
+            const Crossings& e = expected[(v * NUMBER_OF_SLICES) + i];
+            const Crossings& a = actual[(v * NUMBER_OF_SLICES) + i];
+            const double zi = z + (dz * i);
+            bool grazed = false;
+            for (int k = 0; k < SliceKernel::NUMBER_OF_EDGES; ++k) {
+                const unsigned int bit = 1u << k;
+
+                // Allow slices through a corner to differ on whether they cross the edge
+                if ((e.mask & bit) != (a.mask & bit)) {
+                    const double z1 = points[EDGES[k][0]].z;
+                    const double z2 = points[EDGES[k][1]].z;
+                    if (std::min(fabs(zi - z1), fabs(zi - z2)) > TOLERANCE) {
+                        return false;
+                    }
+                    grazed = true;
+                    continue;
+                }
+
+                // Otherwise compare where they cross it
+                if ((e.mask & bit) == 0) {
+                    continue;
+                }
+                for (int c = 0; c < SliceKernel::NUMBER_OF_COMPONENTS; ++c) {
+                    if (fabs(e.values[c][k] - a.values[c][k]) > TOLERANCE) {
+                        return false;
+                    }
+                }
+            }
+            if (grazed) {
+                ++grazing;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Intersects the edges of the cube with a slice the way volumes were sliced before `SliceKernel`.
+ *
+ * @param points Corners of cube in eye space, in the same order as `CORNERS`
+ * @param z Depth of slice in eye space
+ * @param crossings Crossings to store which edges are crossed and where in
+ */
+void SliceBenchmark::cross(const M3d::Vec4 points[8], const double z, Crossings& crossings) {
+    crossings.mask = 0;
+    for (int i = 0; i < SliceKernel::NUMBER_OF_EDGES; ++i) {
+        const M3d::Vec4& p1 = points[EDGES[i][0]];
+        const M3d::Vec4& p2 = points[EDGES[i][1]];
+        if ((p1.z < z) != (p2.z < z)) {
+            const double t = (z - p1.z) / (p2.z - p1.z);
+            const M3d::Vec4& c1 = CORNERS[EDGES[i][0]];
+            const M3d::Vec4& c2 = CORNERS[EDGES[i][1]];
+            crossings.mask |= (1u << i);
+            crossings.values[SliceKernel::X][i] = (float) (p1.x + (t * (p2.x - p1.x)));
+            crossings.values[SliceKernel::Y][i] = (float) (p1.y + (t * (p2.y - p1.y)));
+            crossings.values[SliceKernel::S][i] = (float) (c1.x + (t * (c2.x - c1.x)) + 0.5);
+            crossings.values[SliceKernel::T][i] = (float) (c1.y + (t * (c2.y - c1.y)) + 0.5);
+            crossings.values[SliceKernel::P][i] = (float) (c1.z + (t * (c2.z - c1.z)) + 0.5);
+        }
+    }
+}
+
+/**
+ * Describes the edges of the cube for `SliceKernel` the same way the renderer does.
+ *
+ * @param points Corners of cube in eye space, in the same order as `CORNERS`
+ * @param z Depth of first slice in eye space
+ * @param dz Distance between slices
+ * @param edges Array to store edges in
+ */
+void SliceBenchmark::describe(const M3d::Vec4 points[8],
+                              const double z,
+                              const double dz,
+                              SliceKernel::Edge edges[12]) {
+    for (int i = 0; i < 12; ++i) {
+
+        // Orient edge from back to front
+        int i1 = EDGES[i][0];
+        int i2 = EDGES[i][1];
+        if (points[i1].z > points[i2].z) {
+            std::swap(i1, i2);
+        }
+        const M3d::Vec4& p1 = points[i1];
+        const M3d::Vec4& p2 = points[i2];
+        const M3d::Vec4& c1 = CORNERS[i1];
+        const M3d::Vec4& c2 = CORNERS[i2];
+
+        // Compute where first slice is along edge and how far each slice steps
+        SliceKernel::Edge& edge = edges[i];
+        const double length = p2.z - p1.z;
+        if (length > 0) {
+            edge.u = (z - p1.z) / length;
+            edge.du = dz / length;
+        } else {
+            edge.u = 2;
+            edge.du = 0;
+        }
+
+        // Store start and change of each component
+        edge.start[SliceKernel::X] = p1.x;
+        edge.start[SliceKernel::Y] = p1.y;
+        edge.start[SliceKernel::S] = c1.x + 0.5;
+        edge.start[SliceKernel::T] = c1.y + 0.5;
+        edge.start[SliceKernel::P] = c1.z + 0.5;
+        edge.delta[SliceKernel::X] = p2.x - p1.x;
+        edge.delta[SliceKernel::Y] = p2.y - p1.y;
+        edge.delta[SliceKernel::S] = c2.x - c1.x;
+        edge.delta[SliceKernel::T] = c2.y - c1.y;
+        edge.delta[SliceKernel::P] = c2.z - c1.z;
+    }
+}
+
+/**
+ * Spreads the slices over the depth of the cube, with each slice centered in its slab.
+ *
+ * @param points Corners of cube in eye space
+ * @param z Depth of first slice in eye space
+ * @param dz Distance between slices
+ */
+void SliceBenchmark::findSpacing(const M3d::Vec4 points[8], double& z, double& dz) {
+    double min = points[0].z;
+    double max = points[0].z;
+    for (int i = 1; i < 8; ++i) {
+        min = std::min(min, points[i].z);
+        max = std::max(max, points[i].z);
+    }
+    dz = (max - min) / NUMBER_OF_SLICES;
+    z = min + (dz * 0.5);
+}
+
+/**
+ * Makes views of the cube from directions spread around it, the same every run.
+ *
+ * @return Model-view matrices placing the cube in front of the camera
+ */
+std::vector<M3d::Mat4> SliceBenchmark::makeViews() {
+    M3d::Mat4 translation(1);
+    translation[3] = M3d::Vec4(0, 0, -3, 1);
+    std::vector<M3d::Mat4> views;
+    for (int i = 0; i < NUMBER_OF_VIEWS; ++i) {
+        const double a = (i + 0.5) / NUMBER_OF_VIEWS;
+        const M3d::Vec3 axis = normalize(M3d::Vec3(cos(a * 17), sin(a * 17), (a * 2) - 1));
+        const M3d::Quat rotation = M3d::Quat::fromAxisAngle(axis, a * 6.2831853);
+        views.push_back(translation * rotation.toMat4());
+    }
+    return views;
+}
+
+/**
+ * Runs the benchmark and prints how long each path takes per slice.
+ *
+ * @param out Stream to print results to
+ * @return `true` if every kernel supported by this CPU agrees with the reference
+ */
+bool SliceBenchmark::run(std::ostream& out) {
+
+    // Time the reference
+    const std::vector<M3d::Mat4> views = makeViews();
+    std::vector<Crossings> expected(views.size() * NUMBER_OF_SLICES);
+    const double reference = timeCorners(views, expected);
+    out << std::fixed << std::setprecision(1);
+    out << "[SliceBenchmark] Corners: " << reference << " ns per slice" << std::endl;
+
+    // Time each kernel and check it against the reference
+    const SliceKernel::Implementation implementations[] = {
+        SliceKernel::SCALAR, SliceKernel::SSE2, SliceKernel::AVX2
+    };
+    const char* const names[] = { "Scalar", "SSE2", "AVX2" };
+    bool agreed = true;
+    std::vector<Crossings> actual(expected.size());
+    for (int i = 0; i < 3; ++i) {
+        if (!SliceKernel::isSupported(implementations[i])) {
+            out << "[SliceBenchmark] " << names[i] << ": not supported" << std::endl;
+            continue;
+        }
+        const double time = timeKernel(implementations[i], views, actual);
+        int grazing;
+        const bool agrees = check(views, expected, actual, grazing);
+        out << "[SliceBenchmark] " << names[i] << ": " << time << " ns per slice, "
+            << (reference / time) << "x the reference, ";
+        if (agrees) {
+            out << "agrees (" << grazing << " slices through corners)" << std::endl;
+        } else {
+            out << "DISAGREES" << std::endl;
+        }
+        agreed = agreed && agrees;
+    }
+    return agreed;
+}
+
+/**
+ * Times slicing every view by intersecting every edge with every slice.
+ *
+ * @param views Views to slice the cube from
+ * @param results Vector to store the crossings of each slice of each view in
+ * @return Average time per slice in nanoseconds
+ */
+double SliceBenchmark::timeCorners(const std::vector<M3d::Mat4>& views, std::vector<Crossings>& results) {
+    Poco::Timestamp start;
+    for (int r = 0; r < REPETITIONS; ++r) {
+        for (size_t v = 0; v < views.size(); ++v) {
+            M3d::Vec4 points[8];
+            transform(views[v], points);
+            double z, dz;
+            findSpacing(points, z, dz);
+            for (int i = 0; i < NUMBER_OF_SLICES; ++i) {
+                cross(points, z + (dz * i), results[(v * NUMBER_OF_SLICES) + i]);
+            }
+        }
+    }
+    return (start.elapsed() * 1000.0) / (REPETITIONS * views.size() * NUMBER_OF_SLICES);
+}
+
+/**
+ * Times slicing every view with a kernel, a batch of slices at a time like the renderer.
+ *
+ * @param implementation Implementation of the kernel to use
+ * @param views Views to slice the cube from
+ * @param results Vector to store the crossings of each slice of each view in
+ * @return Average time per slice in nanoseconds
+ */
+double SliceBenchmark::timeKernel(const SliceKernel::Implementation implementation,
+                                  const std::vector<M3d::Mat4>& views,
+                                  std::vector<Crossings>& results) {
+    SliceKernel::Batch batch;
+    SliceKernel::Edge edges[SliceKernel::NUMBER_OF_EDGES];
+    Poco::Timestamp start;
+    for (int r = 0; r < REPETITIONS; ++r) {
+        for (size_t v = 0; v < views.size(); ++v) {
+            M3d::Vec4 points[8];
+            transform(views[v], points);
+            double z, dz;
+            findSpacing(points, z, dz);
+            describe(points, z, dz, edges);
+            for (int first = 0; first < NUMBER_OF_SLICES; first += SliceKernel::BATCH_SIZE) {
+                const int count = std::min(NUMBER_OF_SLICES - first, (int) SliceKernel::BATCH_SIZE);
+                SliceKernel::compute(implementation, edges, first, count, batch);
+                for (int k = 0; k < count; ++k) {
+
+                    // Gather crossed edges, like the renderer does when it assembles a slice
+                    Crossings& crossings = results[(v * NUMBER_OF_SLICES) + first + k];
+                    crossings.mask = batch.masks[k];
+                    for (int e = 0; e < SliceKernel::NUMBER_OF_EDGES; ++e) {
+                        if (crossings.mask & (1u << e)) {
+                            for (int c = 0; c < SliceKernel::NUMBER_OF_COMPONENTS; ++c) {
+                                crossings.values[c][e] = batch.values[c][e][k];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return (start.elapsed() * 1000.0) / (REPETITIONS * views.size() * NUMBER_OF_SLICES);
+}
+
+/**
+ * Moves the corners of the cube into eye space.
+ *
+ * @param view Model-view matrix of the cube
+ * @param points Array to store corners in eye space in, in the same order as `CORNERS`
+ */
+void SliceBenchmark::transform(const M3d::Mat4& view, M3d::Vec4 points[8]) {
+    for (int i = 0; i < 8; ++i) {
+        points[i] = view * CORNERS[i];
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_SLICE_BENCHMARK_H
+#define GANDER_SLICE_BENCHMARK_H
+#include <iosfwd>
+#include <vector>
+#include <m3d/Mat4.h>
+#include <m3d/Vec4.h>
+#include "SliceKernel.h"
+
+
+/**
+ * Microbenchmark timing each `SliceKernel` implementation against intersecting every edge with every slice.
+ *
+ * The reference is how volumes were sliced before the kernel, transforming the corners with `Mat4 * Vec4` and
+ * then testing and interpolating each of the twelve edges for each slice in doubles.  The kernels describe the
+ * edges once per view and then step along them a batch of slices at a time.  Every path cuts the same views
+ * of a unit cube, and the crossings are only ordered into polygons afterwards, which is the same for all of
+ * them, so that part is left out.
+ *
+ * Each kernel's crossings are checked against the reference, allowing for floats instead of doubles.  Slices
+ * passing within a hair of a corner may be counted as crossing an edge by one path but not the other, so
+ * those are only counted, not treated as disagreeing.
+ */
+class SliceBenchmark {
+public:
+// Methods
+    static bool run(std::ostream& out);
+private:
+// Types
+    struct Crossings {
+        unsigned int mask;
+        float values[SliceKernel::NUMBER_OF_COMPONENTS][SliceKernel::NUMBER_OF_EDGES];
+    };
+// Constants
+    static const int NUMBER_OF_VIEWS = 64;
+    static const int NUMBER_OF_SLICES = 512;
+    static const int REPETITIONS = 20;
+    static const double TOLERANCE;
+    static const M3d::Vec4 CORNERS[8];
+    static const int EDGES[12][2];
+// Methods
+    static bool check(const std::vector<M3d::Mat4>& views,
+                      const std::vector<Crossings>& expected,
+                      const std::vector<Crossings>& actual,
+                      int& grazing);
+    static void cross(const M3d::Vec4 points[8], double z, Crossings& crossings);
+    static void describe(const M3d::Vec4 points[8], double z, double dz, SliceKernel::Edge edges[12]);
+    static void findSpacing(const M3d::Vec4 points[8], double& z, double& dz);
+    static std::vector<M3d::Mat4> makeViews();
+    static double timeCorners(const std::vector<M3d::Mat4>& views, std::vector<Crossings>& results);
+    static double timeKernel(SliceKernel::Implementation implementation,
+                             const std::vector<M3d::Mat4>& views,
+                             std::vector<Crossings>& results);
+    static void transform(const M3d::Mat4& view, M3d::Vec4 points[8]);
+};
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "SliceKernel.h"
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define GANDER_SLICE_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// Best implementation supported by this CPU
+const SliceKernel::function_t SliceKernel::FUNCTION = SliceKernel::selectFunction();
+
+/**
+ * Computes where edges cross a run of slices.
+ *
+ * A slice crosses an edge when its parameter along the edge, `u + (i * du)` for slice `i`, is in (0, 1].
+ *
+ * @param edges Edges of the volume
+ * @param first Index of first slice to compute
+ * @param count Number of slices to compute, at most `BATCH_SIZE`
+ * @param batch Batch to store positions, coordinates, and masks of crossed edges in
+ * @throws std::invalid_argument if count is negative or greater than `BATCH_SIZE`
+ */
+void SliceKernel::compute(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+    if ((count < 0) || (count > BATCH_SIZE)) {
+        throw std::invalid_argument("[SliceKernel] Count is out of range!");
+    }
+    FUNCTION(edges, first, count, batch);
+}
+
+/**
+ * Computes where edges cross a run of slices with a particular implementation.
+ *
+ * @param implementation Implementation to use, which must be supported by this CPU
+ * @param edges Edges of the volume
+ * @param first Index of first slice to compute
+ * @param count Number of slices to compute, at most `BATCH_SIZE`
+ * @param batch Batch to store positions, coordinates, and masks of crossed edges in
+ * @throws std::invalid_argument if implementation isn't supported, or count is negative or greater than
+ *         `BATCH_SIZE`
+ */
+void SliceKernel::compute(const Implementation implementation,
+                          const Edge edges[NUMBER_OF_EDGES],
+                          const int first,
+                          const int count,
+                          Batch& batch) {
+    if (!isSupported(implementation)) {
+        throw std::invalid_argument("[SliceKernel] Implementation is not supported!");
+    } else if ((count < 0) || (count > BATCH_SIZE)) {
+        throw std::invalid_argument("[SliceKernel] Count is out of range!");
+    }
+    switch (implementation) {
+    case AVX2:
+        computeAvx2(edges, first, count, batch);
+        break;
+    case SSE2:
+        computeSse2(edges, first, count, batch);
+        break;
+    default:
+        computeScalar(edges, first, count, batch);
+        break;
+    }
+}
+
+#ifdef GANDER_SLICE_KERNEL_X86
+/**
+ * Computes where edges cross a run of slices eight slices at a time with AVX2.
+ */
+__attribute__((target("avx2")))
+void SliceKernel::computeAvx2(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 eight = _mm256_set1_ps(8.0f);
+    const __m256 lanes = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (int k = 0; k < BATCH_SIZE; ++k) {
+        batch.masks[k] = 0;
+    }
+
+    for (int e = 0; e < NUMBER_OF_EDGES; ++e) {
+        const Edge& edge = edges[e];
+        const __m256 u0 = _mm256_set1_ps(edge.u);
+        const __m256 du = _mm256_set1_ps(edge.du);
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float) first), lanes);
+        for (int k = 0; k < count; k += 8) {
+
+            // Step along the edge
+            const __m256 u = _mm256_add_ps(u0, _mm256_mul_ps(index, du));
+            index = _mm256_add_ps(index, eight);
+
+            // Record which slices cross it
+            const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+            int bits = _mm256_movemask_ps(inside);
+            while (bits != 0) {
+                batch.masks[k + __builtin_ctz(bits)] |= (1u << e);
+                bits &= bits - 1;
+            }
+
+            // Interpolate components
+            for (int c = 0; c < NUMBER_OF_COMPONENTS; ++c) {
+                const __m256 start = _mm256_set1_ps(edge.start[c]);
+                const __m256 delta = _mm256_set1_ps(edge.delta[c]);
+                _mm256_storeu_ps(&batch.values[c][e][k], _mm256_add_ps(start, _mm256_mul_ps(u, delta)));
+            }
+        }
+    }
+}
+#else
+/**
+ * Computes where edges cross a run of slices one slice at a time, since AVX2 isn't available here.
+ */
+void SliceKernel::computeAvx2(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+    computeScalar(edges, first, count, batch);
+}
+#endif
+
+/**
+ * Computes where edges cross a run of slices one slice at a time.
+ */
+void SliceKernel::computeScalar(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+
+    for (int k = 0; k < count; ++k) {
+        batch.masks[k] = 0;
+    }
+
+    for (int e = 0; e < NUMBER_OF_EDGES; ++e) {
+        const Edge& edge = edges[e];
+        for (int k = 0; k < count; ++k) {
+            const float u = edge.u + ((first + k) * edge.du);
+            if ((u > 0) && (u <= 1)) {
+                batch.masks[k] |= (1u << e);
+            }
+            for (int c = 0; c < NUMBER_OF_COMPONENTS; ++c) {
+                batch.values[c][e][k] = edge.start[c] + (u * edge.delta[c]);
+            }
+        }
+    }
+}
+
+#ifdef GANDER_SLICE_KERNEL_X86
+/**
+ * Computes where edges cross a run of slices four slices at a time with SSE2.
+ */
+__attribute__((target("sse2")))
+void SliceKernel::computeSse2(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 lanes = _mm_set_ps(3, 2, 1, 0);
+
+    for (int k = 0; k < BATCH_SIZE; ++k) {
+        batch.masks[k] = 0;
+    }
+
+    for (int e = 0; e < NUMBER_OF_EDGES; ++e) {
+        const Edge& edge = edges[e];
+        const __m128 u0 = _mm_set1_ps(edge.u);
+        const __m128 du = _mm_set1_ps(edge.du);
+        __m128 index = _mm_add_ps(_mm_set1_ps((float) first), lanes);
+        for (int k = 0; k < count; k += 4) {
+
+            // Step along the edge
+            const __m128 u = _mm_add_ps(u0, _mm_mul_ps(index, du));
+            index = _mm_add_ps(index, four);
+
+            // Record which slices cross it
+            const __m128 inside = _mm_and_ps(_mm_cmpgt_ps(u, zero), _mm_cmple_ps(u, one));
+            int bits = _mm_movemask_ps(inside);
+            while (bits != 0) {
+                batch.masks[k + __builtin_ctz(bits)] |= (1u << e);
+                bits &= bits - 1;
+            }
+
+            // Interpolate components
+            for (int c = 0; c < NUMBER_OF_COMPONENTS; ++c) {
+                const __m128 start = _mm_set1_ps(edge.start[c]);
+                const __m128 delta = _mm_set1_ps(edge.delta[c]);
+                _mm_storeu_ps(&batch.values[c][e][k], _mm_add_ps(start, _mm_mul_ps(u, delta)));
+            }
+        }
+    }
+}
+#else
+/**
+ * Computes where edges cross a run of slices one slice at a time, since SSE2 isn't available here.
+ */
+void SliceKernel::computeSse2(const Edge edges[NUMBER_OF_EDGES], const int first, const int count, Batch& batch) {
+    computeScalar(edges, first, count, batch);
+}
+#endif
+
+/**
+ * Checks if this CPU supports an implementation.
+ *
+ * @param implementation Implementation to check
+ * @return `true` if the implementation can be used
+ */
+bool SliceKernel::isSupported(const Implementation implementation) {
+    switch (implementation) {
+#ifdef GANDER_SLICE_KERNEL_X86
+    case AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+#endif
+    case SCALAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Picks the best implementation this CPU supports.
+ */
+SliceKernel::function_t SliceKernel::selectFunction() {
+#ifdef GANDER_SLICE_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &computeAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        return &computeSse2;
+    }
+#endif
+    return &computeScalar;
+}
@@ -0,0 +1,74 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_SLICE_KERNEL_H
+#define GANDER_SLICE_KERNEL_H
+
+
+/**
+ * Computes where the edges of a volume cross a run of evenly spaced slices.
+ *
+ * Each edge is described by where it starts and how far the slices step along it, so crossing a slice is
+ * a multiply-add per component rather than a matrix multiply per corner.  Results are written in
+ * structure-of-arrays form so several slices can be computed at once with SSE2 or AVX2 when the CPU
+ * supports them, falling back to plain loops otherwise.  Each implementation can also be asked for by name,
+ * which `SliceBenchmark` uses to time them against each other.
+ */
+class SliceKernel {
+public:
+// Constants
+    static const int BATCH_SIZE = 64;
+    static const int NUMBER_OF_EDGES = 12;
+    static const int NUMBER_OF_COMPONENTS = 5;
+    static const int X = 0;
+    static const int Y = 1;
+    static const int S = 2;
+    static const int T = 3;
+    static const int P = 4;
+// Types
+    enum Implementation { SCALAR, SSE2, AVX2 };
+    struct Edge {
+        float u;
+        float du;
+        float start[NUMBER_OF_COMPONENTS];
+        float delta[NUMBER_OF_COMPONENTS];
+    };
+    struct Batch {
+        float values[NUMBER_OF_COMPONENTS][NUMBER_OF_EDGES][BATCH_SIZE];
+        unsigned int masks[BATCH_SIZE];
+    };
+// Methods
+    static void compute(const Edge edges[NUMBER_OF_EDGES], int first, int count, Batch& batch);
+    static void compute(Implementation implementation,
+                        const Edge edges[NUMBER_OF_EDGES],
+                        int first,
+                        int count,
+                        Batch& batch);
+    static bool isSupported(Implementation implementation);
+private:
+// Types
+    typedef void (*function_t)(const Edge edges[NUMBER_OF_EDGES], int first, int count, Batch& batch);
+// Constants
+    static const function_t FUNCTION;
+// Methods
+    static void computeAvx2(const Edge edges[NUMBER_OF_EDGES], int first, int count, Batch& batch);
+    static void computeScalar(const Edge edges[NUMBER_OF_EDGES], int first, int count, Batch& batch);
+    static void computeSse2(const Edge edges[NUMBER_OF_EDGES], int first, int count, Batch& batch);
+    static function_t selectFunction();
+};
+
+#endif
@@ -18,128 +18,797 @@
 #include "config.h"
 #include "SlicingVolumeRendererNode.h"
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <limits>
-#include <stack>
 #include <gloop/TextureTarget.hxx>
 #include <RapidGL/AttributeNode.h>
+#include <RapidGL/FramebufferNode.h>
 #include <RapidGL/TextureNode.h>
 #include <RapidGL/TransformNode.h>
 #include <RapidGL/UseNode.h>
 
+// Corners of the unit cube a volume occupies in model space
+const M3d::Vec4 SlicingVolumeRendererNode::CORNERS[] = {
+    M3d::Vec4(-0.5, -0.5, -0.5, 1.0),
+    M3d::Vec4(-0.5, -0.5, +0.5, 1.0),
+    M3d::Vec4(-0.5, +0.5, -0.5, 1.0),
+    M3d::Vec4(-0.5, +0.5, +0.5, 1.0),
+    M3d::Vec4(+0.5, -0.5, -0.5, 1.0),
+    M3d::Vec4(+0.5, -0.5, +0.5, 1.0),
+    M3d::Vec4(+0.5, +0.5, -0.5, 1.0),
+    M3d::Vec4(+0.5, +0.5, +0.5, 1.0)
+};
+
+// Edges of the unit cube, as pairs of indices into `CORNERS`
+const int SlicingVolumeRendererNode::EDGES[][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
 /**
  * Constructs a `SlicingVolumeRendererNode`.
  *
  * @param strategy Strategy to render with
- * @param numberOfSlices Number of slices to create for each volume
- * @throws std::invalid_argument if name of uniform is empty
+ * @param numberOfSlices Most slices to create for each volume
+ * @param interactiveSlices Most slices to create for each volume while the view or volumes are moving
+ * @param spacing Distance between planes shared by all volumes in eye space, or zero to slice each on its own
+ * @param mode How slices are blended together
+ * @param jitterUnit Texture unit to bind noise for jittering samples to, or negative to not jitter
+ * @param passes Number of passes to average while nothing moves, or one to not refine
+ * @param depthId Identifier of texture node holding depth of the opaque scene, or empty to slice everything
+ * @param threshold Opacity at which pixels stop taking slices when compositing front to back
+ * @param interval Number of slices drawn between masking off opaque pixels when compositing front to back
+ * @param downsample Number the size of the viewport is divided by to draw volumes, either 1, 2, or 4
+ * @param interactiveDownsample Number to divide the size of the viewport by while things are moving instead
+ * @throws std::invalid_argument if interval is not positive, or either downsample is not 1, 2, or 4
  */
 SlicingVolumeRendererNode::SlicingVolumeRendererNode(Strategy* const strategy,
-                                                     const int numberOfSlices) :
+                                                     const int numberOfSlices,
+                                                     const int interactiveSlices,
+                                                     const double spacing,
+                                                     const Mode mode,
+                                                     const GLint jitterUnit,
+                                                     const int passes,
+                                                     const std::string& depthId,
+                                                     const GLfloat threshold,
+                                                     const int interval,
+                                                     const int downsample,
+                                                     const int interactiveDownsample) :
         ready(false),
-        arrayBuffer(Gloop::BufferTarget::arrayBuffer()),
+        enabled(true),
         numberOfSlices(numberOfSlices),
+        interactiveSlices(interactiveSlices),
+        spacing(spacing),
+        mode(mode),
+        jitterUnit(jitterUnit),
+        jitterTexture(0),
+        jitterLocation(-1),
+        passes(passes),
+        pass(0),
+        depthId(depthId),
+        depthUnit(-1),
+        threshold(threshold),
+        interval(interval),
+        downsample(downsample),
+        interactiveDownsample(interactiveDownsample),
         strategy(strategy),
         vao(Gloop::VertexArrayObject::generate()),
-        vbo(Gloop::BufferObject::generate()) {
-    // empty
+        workerPool(WorkerPool::getInstance()),
+        data(NULL),
+        moved(false),
+        interacting(false) {
+    if (interval <= 0) {
+        throw std::invalid_argument("[SlicingVolumeRendererNode] Interval is not positive!");
+    }
+    const int divisors[2] = { downsample, interactiveDownsample };
+    for (int i = 0; i < 2; ++i) {
+        if ((divisors[i] != 1) && (divisors[i] != 2) && (divisors[i] != 4)) {
+            throw std::invalid_argument("[SlicingVolumeRendererNode] Downsample must be 1, 2, or 4!");
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        viewport[i] = 0;
+    }
 }
 
 /**
- * Destructs a `SlicingVolumeRendererNode`.
+ * Destructs a `SlicingVolumeRendererNode`, no longer observing its volumes or the transform nodes above them.
  */
 SlicingVolumeRendererNode::~SlicingVolumeRendererNode() {
+
+    // Stop observing nodes
+    std::multimap<RapidGL::Node*,VolumeNode*>::const_iterator it = volumeNodesByTransformNode.begin();
+    while (it != volumeNodesByTransformNode.end()) {
+        it->first->removeNodeListener(this);
+        it = volumeNodesByTransformNode.upper_bound(it->first);
+    }
+    for (std::vector<VolumeNode*>::const_iterator v = volumeNodes.begin(); v != volumeNodes.end(); ++v) {
+        (*v)->removeNodeListener(this);
+    }
+    for (std::set<RapidGL::Node*>::const_iterator n = sceneNodes.begin(); n != sceneNodes.end(); ++n) {
+        (*n)->removeNodeListener(this);
+    }
+
+    // Delete resources
     vao.dispose();
-    vbo.dispose();
+    if (jitterTexture != 0) {
+        glDeleteTextures(1, &jitterTexture);
+    }
+}
+
+/**
+ * Builds the polygon where a slice cuts a volume from the edges it crosses.
+ *
+ * @param batch Batch computed by `SliceKernel`
+ * @param k Index of slice in batch
+ * @param out Array to store vertices of polygon in, in counter-clockwise order
+ * @return Number of vertices in polygon, or zero if it is not a polygon
+ */
+int SlicingVolumeRendererNode::assemble(const SliceKernel::Batch& batch, const int k, Vertex* out) {
+
+    // Gather crossed edges
+    const unsigned int mask = batch.masks[k];
+    int count = 0;
+    double cx = 0;
+    double cy = 0;
+    for (int e = 0; e < SliceKernel::NUMBER_OF_EDGES; ++e) {
+        if (mask & (1u << e)) {
+            Vertex* const v = &out[count++];
+            v->x = batch.values[SliceKernel::X][e][k];
+            v->y = batch.values[SliceKernel::Y][e][k];
+            v->s = batch.values[SliceKernel::S][e][k];
+            v->t = batch.values[SliceKernel::T][e][k];
+            v->p = batch.values[SliceKernel::P][e][k];
+            cx += v->x;
+            cy += v->y;
+        }
+    }
+    if (count < 3) {
+        return 0;
+    }
+
+    // Order them by angle around their center
+    cx /= count;
+    cy /= count;
+    double angles[SliceKernel::NUMBER_OF_EDGES];
+    for (int i = 0; i < count; ++i) {
+        angles[i] = getPseudoAngle(out[i].x - cx, out[i].y - cy);
+    }
+    for (int i = 1; i < count; ++i) {
+        const Vertex vertex = out[i];
+        const double angle = angles[i];
+        int j = i;
+        while ((j > 0) && (angles[j - 1] > angle)) {
+            out[j] = out[j - 1];
+            angles[j] = angles[j - 1];
+            --j;
+        }
+        out[j] = vertex;
+        angles[j] = angle;
+    }
+    return count;
+}
+
+/**
+ * Turns on the depth test without depth writes if slicing stops at the scene.
+ *
+ * @return Depth state to put back with `endDepth`
+ */
+SlicingVolumeRendererNode::Depth SlicingVolumeRendererNode::beginDepth() const {
+
+    // Leave depth alone if not stopping at the scene
+    Depth depth = Depth();
+    if (depthUnit < 0) {
+        return depth;
+    }
+
+    // Save current state, then test against the scene without covering it up
+    depth.testing = glIsEnabled(GL_DEPTH_TEST);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depth.writing);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    return depth;
+}
+
+/**
+ * Sets up blending for the mode, unless compositing straight into the framebuffer with whatever blending the
+ * scene set up.
+ *
+ * When compositing into an offscreen target instead, the scene's blending is kept for color, but alpha is
+ * blended so the target ends up premultiplied, since it starts out transparent.
+ *
+ * @param offscreen Whether slices are drawn into the compositor's target or the accumulator's pass
+ * @return Blending state to put back with `endMode`
+ */
+SlicingVolumeRendererNode::Blending SlicingVolumeRendererNode::beginMode(const bool offscreen) const {
+
+    // Leave blending alone when compositing into the framebuffer
+    Blending blending = Blending();
+    if ((mode == COMPOSITE) && !offscreen) {
+        return blending;
+    }
+
+    // Save current state
+    blending.saved = true;
+    blending.enabled = glIsEnabled(GL_BLEND);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &blending.equationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blending.equationAlpha);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blending.sourceRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blending.destinationRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blending.sourceAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blending.destinationAlpha);
+
+    // Change it for the mode
+    glEnable(GL_BLEND);
+    switch (mode) {
+    case COMPOSITE:
+        glBlendFuncSeparate(blending.sourceRgb, blending.destinationRgb, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case MAXIMUM:
+        glBlendEquation(GL_MAX);
+        break;
+    case MINIMUM:
+        glBlendEquation(GL_MIN);
+        break;
+    case FRONT_TO_BACK:
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFuncSeparate(GL_ONE_MINUS_DST_ALPHA, GL_ONE, GL_ONE_MINUS_DST_ALPHA, GL_ONE);
+        break;
+    default:
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_ONE, GL_ONE);
+        break;
+    }
+    return blending;
+}
+
+/**
+ * Clips a polygon against a plane.
+ *
+ * @param in Vertices of polygon to clip
+ * @param count Number of vertices in polygon
+ * @param distances Signed distance of each vertex to plane, where vertices with a non-negative distance are kept
+ * @param out Array to store vertices of clipped polygon in, with room for one more vertex than `in`
+ * @return Number of vertices in clipped polygon
+ */
+int SlicingVolumeRendererNode::clip(const Vertex* in,
+                                    const int count,
+                                    const double distances[],
+                                    Vertex* out) {
+
+    // Walk edges, keeping inside vertices and adding crossings
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        const int j = (i + 1) % count;
+        const Vertex& v1 = in[i];
+        const Vertex& v2 = in[j];
+        const double d1 = distances[i];
+        const double d2 = distances[j];
+        if (d1 >= 0) {
+            out[n++] = v1;
+        }
+        if ((d1 >= 0) != (d2 >= 0)) {
+            const double t = d1 / (d1 - d2);
+            Vertex* const v = &out[n++];
+            v->x = v1.x + (t * (v2.x - v1.x));
+            v->y = v1.y + (t * (v2.y - v1.y));
+            v->s = v1.s + (t * (v2.s - v1.s));
+            v->t = v1.t + (t * (v2.t - v1.t));
+            v->p = v1.p + (t * (v2.p - v1.p));
+        }
+    }
+    return n;
 }
 
 /**
- * Compares two quads according to their depths.
+ * Clips a slice against the view frustum.
  *
- * @param q1 First quad
- * @param q2 Second quad
- * @return `true` if the first quad should go before the second quad
+ * @param slice Slice to clip, which will have its vertices replaced
+ * @param planes Planes of the view frustum in eye space
  */
-bool SlicingVolumeRendererNode::compare(const Quad& q1, const Quad& q2) {
-    return q2.z > q1.z;
+void SlicingVolumeRendererNode::clip(Slice& slice, const M3d::Vec4 planes[6]) {
+    Vertex vertices[MAX_VERTICES_PER_SLICE];
+    double distances[MAX_VERTICES_PER_SLICE];
+    for (int i = 0; (i < 6) && (slice.count >= 3); ++i) {
+        const M3d::Vec4& plane = planes[i];
+        for (int j = 0; j < slice.count; ++j) {
+            const Vertex& v = slice.vertices[j];
+            distances[j] = (plane.x * v.x) + (plane.y * v.y) + (plane.z * slice.z) + plane.w;
+        }
+        const int count = clip(slice.vertices, slice.count, distances, vertices);
+        std::copy(vertices, vertices + count, slice.vertices);
+        slice.count = count;
+    }
+}
+
+/**
+ * Trims a slice down to the bricks of a volume that can be seen.
+ *
+ * @param slice Slice to trim, which must be inside the volume
+ * @param occupancyGrid Grid recording which bricks of the volume can be seen
+ * @return `false` if the slice doesn't touch any bricks that can be seen
+ */
+bool SlicingVolumeRendererNode::clip(Slice& slice, const OccupancyGrid& occupancyGrid) {
+
+    // Find box around slice in texture coordinates
+    double min[3];
+    double max[3];
+    findBox(slice, min, max);
+
+    // Find part of box with bricks that can be seen
+    double boundsMin[3];
+    double boundsMax[3];
+    if (!occupancyGrid.findBounds(min, max, boundsMin, boundsMax)) {
+        return false;
+    }
+
+    // Clip against sides of that part that cut through the slice
+    Vertex vertices[MAX_VERTICES_PER_SLICE];
+    double distances[MAX_VERTICES_PER_SLICE];
+    for (int i = 0; (i < 6) && (slice.count >= 3); ++i) {
+        const int axis = i / 2;
+        const bool lower = (i % 2) == 0;
+        const double bound = lower ? boundsMin[axis] : boundsMax[axis];
+        if (lower ? (bound <= min[axis]) : (bound >= max[axis])) {
+            continue;
+        }
+        for (int j = 0; j < slice.count; ++j) {
+            const Vertex& v = slice.vertices[j];
+            const double coordinate = (axis == 0) ? v.s : ((axis == 1) ? v.t : v.p);
+            distances[j] = lower ? (coordinate - bound) : (bound - coordinate);
+        }
+        const int count = clip(slice.vertices, slice.count, distances, vertices);
+        std::copy(vertices, vertices + count, slice.vertices);
+        slice.count = count;
+    }
+    return slice.count >= 3;
 }
 
 /**
- * Determines the minimum and maximum positions of a volume in eye space.
+ * Trims a slice to where it could be seen in front of the scene.
+ *
+ * Relies on slices facing the viewer, so the whole slice has the same depth.
  *
- * @param volumeNode Volume to determine minimum and maximum of
- * @param viewMatrix Current view matrix, which transforms world coordinates to eye coordinates
- * @return Minimum and maximum of volume in eye space, as an `Extent`
+ * @param slice Slice to trim, in eye space
+ * @param depthGrid Farthest depth of the scene in each tile of the screen
+ * @param projectionMatrix Projection from eye space to clip space
+ * @return `false` if the slice is hidden by the scene everywhere
  */
-SlicingVolumeRendererNode::Extent SlicingVolumeRendererNode::findExtent(const VolumeNode* volumeNode,
-                                                                        const M3d::Mat4& viewMatrix) {
+bool SlicingVolumeRendererNode::clip(Slice& slice,
+                                     const DepthGrid& depthGrid,
+                                     const M3d::Mat4& projectionMatrix) {
+
+    // Skip if there's no depth to compare against
+    if (!depthGrid.isBuilt()) {
+        return true;
+    }
 
-    // Compute model view matrix
-    const M3d::Mat4 modelMatrix = getModelMatrix(volumeNode);
-    const M3d::Mat4 modelViewMatrix = viewMatrix * modelMatrix;
+    // Find depth of slice
+    const M3d::Vec4 center = projectionMatrix * M3d::Vec4(0, 0, slice.z, 1);
+    if (center.w <= 0) {
+        return true;
+    }
+    const double depth = ((center.z / center.w) + 1) * 0.5;
+
+    // Find bounds of slice on screen
+    double min[2] = { 1, 1 };
+    double max[2] = { 0, 0 };
+    for (int i = 0; i < slice.count; ++i) {
+        const Vertex& v = slice.vertices[i];
+        const M3d::Vec4 p = projectionMatrix * M3d::Vec4(v.x, v.y, slice.z, 1);
+        for (int j = 0; j < 2; ++j) {
+            const double coordinate = ((p[j] / p.w) + 1) * 0.5;
+            min[j] = std::min(min[j], coordinate);
+            max[j] = std::max(max[j], coordinate);
+        }
+    }
 
-    // Create points
-    const M3d::Vec4 points[] = {
-        M3d::Vec4(-0.5, -0.5, -0.5, 1.0),
-        M3d::Vec4(-0.5, -0.5, +0.5, 1.0),
-        M3d::Vec4(-0.5, +0.5, -0.5, 1.0),
-        M3d::Vec4(-0.5, +0.5, +0.5, 1.0),
-        M3d::Vec4(+0.5, -0.5, -0.5, 1.0),
-        M3d::Vec4(+0.5, -0.5, +0.5, 1.0),
-        M3d::Vec4(+0.5, +0.5, -0.5, 1.0),
-        M3d::Vec4(+0.5, +0.5, +0.5, 1.0)
-    };
+    // Check which tiles it could be seen in
+    double visibleMin[2];
+    double visibleMax[2];
+    if (!depthGrid.findVisible(min, max, depth, visibleMin, visibleMax)) {
+        return false;
+    }
+
+    // Trim it to those tiles by narrowing the sides of the frustum
+    M3d::Vec4 planes[6];
+    findFrustum(projectionMatrix, planes);
+    for (int i = 0; i < 2; ++i) {
+        const double low = (visibleMin[i] * 2) - 1;
+        const double high = (visibleMax[i] * 2) - 1;
+        for (int j = 0; j < 4; ++j) {
+            const double w = projectionMatrix[j][3];
+            const double c = projectionMatrix[j][i];
+            planes[i * 2][j] = c - (low * w);
+            planes[i * 2 + 1][j] = (high * w) - c;
+        }
+    }
+    clip(slice, planes);
+    return slice.count >= 3;
+}
 
-    // Transform points
-    std::vector<M3d::Vec4> transformedPoints;
+/**
+ * Cuts the part of a slice between two texture coordinates along an axis.
+ *
+ * @param slice Slice to cut from
+ * @param axis Index of texture coordinate, where 0 is S, 1 is T, and 2 is P
+ * @param min Smallest texture coordinate to keep
+ * @param max Largest texture coordinate to keep
+ * @param piece Slice to store the part in
+ * @return `false` if no part of the slice is between the coordinates
+ */
+bool SlicingVolumeRendererNode::clip(const Slice& slice,
+                                     const int axis,
+                                     const double min,
+                                     const double max,
+                                     Slice& piece) {
+
+    piece.unit = slice.unit;
+    piece.correction = slice.correction;
+    std::copy(slice.offset, slice.offset + 3, piece.offset);
+    piece.z = slice.z;
+    piece.plane = slice.plane;
+
+    // Clip against lower side, then upper side
+    Vertex vertices[MAX_VERTICES_PER_SLICE];
+    double distances[MAX_VERTICES_PER_SLICE];
+    for (int i = 0; i < slice.count; ++i) {
+        const Vertex& v = slice.vertices[i];
+        distances[i] = ((axis == 0) ? v.s : ((axis == 1) ? v.t : v.p)) - min;
+    }
+    const int count = clip(slice.vertices, slice.count, distances, vertices);
+    for (int i = 0; i < count; ++i) {
+        const Vertex& v = vertices[i];
+        distances[i] = max - ((axis == 0) ? v.s : ((axis == 1) ? v.t : v.p));
+    }
+    piece.count = clip(vertices, count, distances, piece.vertices);
+    return piece.count >= 3;
+}
+
+/**
+ * Constructs a `Cursor` at the start of a vector of slices.
+ *
+ * @param slices Vector of slices to walk, which must not be empty
+ */
+SlicingVolumeRendererNode::Cursor::Cursor(const std::vector<Slice>& slices) :
+        slice(&slices.front()),
+        end(&slices.front() + slices.size()) {
+    // empty
+}
+
+/**
+ * Checks if this cursor's slice should go after another cursor's slice.
+ *
+ * @param that Other cursor
+ * @return `true` if this cursor's slice is in front of the other cursor's slice
+ */
+bool SlicingVolumeRendererNode::Cursor::operator>(const Cursor& that) const {
+    return slice->z > that.slice->z;
+}
+
+/**
+ * Determines how many slices to cut a volume into.
+ *
+ * A volume never gets more slices than the number of pixels it covers on screen, since the extra slices would
+ * barely change the image.  While the view or volumes are moving the count is scaled down further, and it is
+ * raised back once they settle.
+ *
+ * @param points Corners of volume in eye space
+ * @return Number of slices to cut volume into
+ */
+int SlicingVolumeRendererNode::countSlices(const M3d::Vec4 points[8]) const {
+
+    // Find bounds of volume in normalized device coordinates
+    double minX = 1;
+    double minY = 1;
+    double maxX = -1;
+    double maxY = -1;
     for (int i = 0; i < 8; ++i) {
-        transformedPoints.push_back(modelViewMatrix * points[i]);
+        const M3d::Vec4 p = projectionMatrix * points[i];
+        if (p.w <= 0) {
+            minX = minY = -1;
+            maxX = maxY = 1;
+            break;
+        }
+        minX = std::min(minX, p.x / p.w);
+        minY = std::min(minY, p.y / p.w);
+        maxX = std::max(maxX, p.x / p.w);
+        maxY = std::max(maxY, p.y / p.w);
+    }
+
+    // Limit to number of pixels covered
+    const double width = (std::min(maxX, 1.0) - std::max(minX, -1.0)) * viewport[2] * 0.5;
+    const double height = (std::min(maxY, 1.0) - std::max(minY, -1.0)) * viewport[3] * 0.5;
+    const double pixels = std::max(width, height);
+    int count = numberOfSlices;
+    if (pixels < count) {
+        count = ((int) pixels) + 1;
+    }
+
+    // Scale down while interacting
+    if (interacting && (numberOfSlices > 0)) {
+        count = (count * interactiveSlices) / numberOfSlices;
+    }
+
+    // Keep a minimum so the volume doesn't fall apart
+    const int minimum = std::min(numberOfSlices, (int) MIN_SLICES);
+    return std::max(count, minimum);
+}
+
+/**
+ * Determines how many vertices are needed to draw a slice as a triangle fan.
+ *
+ * @param slice Slice to count vertices of
+ * @return Number of vertices needed to draw slice
+ */
+int SlicingVolumeRendererNode::countVertices(const Slice& slice) {
+    return slice.count;
+}
+
+/**
+ * Draws the slices or proxies, going through the compositor if compositing front to back or downsampling.
+ *
+ * @param accumulating Whether drawing into the accumulator's cleared pass, which is laid over the scene later
+ */
+void SlicingVolumeRendererNode::draw(const bool accumulating) {
+
+    // Start drawing into the compositor, clearing to a value the mode's blending leaves alone
+    const int divisor = interacting ? interactiveDownsample : downsample;
+    const bool offscreen = (mode == FRONT_TO_BACK) || (divisor > 1);
+    if (offscreen) {
+        compositor.begin(divisor, (mode == MINIMUM) ? 1.0f : 0.0f);
+    }
+
+    // Draw
+    const Blending blending = beginMode(offscreen || accumulating);
+    if (strategy->usesProxies()) {
+        strategy->draw(proxies);
+    } else if (mode == FRONT_TO_BACK) {
+        drawFrontToBack();
+    } else {
+        strategy->draw(runs, firsts, counts);
+    }
+    endMode(blending);
+
+    // Lay the compositor's target over the scene the same way slices would have been blended into it
+    if (offscreen) {
+        GLenum equation, source, destination;
+        findOverlay(equation, source, destination);
+        compositor.end(equation, source, destination);
+    }
+}
+
+/**
+ * Draws slices front to back into the compositor in groups, masking off opaque pixels after each group.
+ *
+ * Runs are split where a group ends, so a group may end partway through a run.
+ */
+void SlicingVolumeRendererNode::drawFrontToBack() {
+
+    std::vector<Run> group;
+    int slicesInGroup = 0;
+    int slicesLeft = firsts.size();
+    for (std::vector<Run>::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+        Run rest = *it;
+        while (rest.count > 0) {
+
+            // Add as much of the run as fits in the group
+            Run piece = rest;
+            piece.count = std::min(rest.count, (GLsizei) (interval - slicesInGroup));
+            group.push_back(piece);
+            slicesInGroup += piece.count;
+            slicesLeft -= piece.count;
+            rest.first += piece.count;
+            rest.count -= piece.count;
+
+            // Draw a full group, then mask off what's opaque if anything is left to draw
+            if (slicesInGroup == interval) {
+                strategy->draw(group, firsts, counts);
+                if (slicesLeft > 0) {
+                    compositor.mask(threshold);
+                }
+                group.clear();
+                slicesInGroup = 0;
+            }
+        }
+    }
+    if (!group.empty()) {
+        strategy->draw(group, firsts, counts);
+    }
+}
+
+/**
+ * Puts back depth state changed by `beginDepth`.
+ *
+ * @param depth Depth state returned by `beginDepth`
+ */
+void SlicingVolumeRendererNode::endDepth(const Depth& depth) const {
+    if (depthUnit < 0) {
+        return;
+    }
+    glDepthMask(depth.writing);
+    if (!depth.testing) {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+/**
+ * Puts back blending changed by `beginMode`.
+ *
+ * @param blending Blending state returned by `beginMode`
+ */
+void SlicingVolumeRendererNode::endMode(const Blending& blending) const {
+    if (!blending.saved) {
+        return;
+    }
+    glBlendEquationSeparate(blending.equationRgb, blending.equationAlpha);
+    glBlendFuncSeparate(blending.sourceRgb, blending.destinationRgb, blending.sourceAlpha, blending.destinationAlpha);
+    if (!blending.enabled) {
+        glDisable(GL_BLEND);
+    }
+}
+
+/**
+ * Checks if two matrices are exactly the same.
+ *
+ * @param m1 First matrix
+ * @param m2 Second matrix
+ * @return `true` if every element of the matrices is equal
+ */
+bool SlicingVolumeRendererNode::equals(const M3d::Mat4& m1, const M3d::Mat4& m2) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (m1[i][j] != m2[i][j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Finds the box around a slice in texture coordinates.
+ *
+ * @param slice Slice to find box around
+ * @param min Array to store smallest texture coordinates in
+ * @param max Array to store largest texture coordinates in
+ */
+void SlicingVolumeRendererNode::findBox(const Slice& slice, double min[3], double max[3]) {
+    for (int i = 0; i < 3; ++i) {
+        min[i] = 1;
+        max[i] = 0;
+    }
+    for (int i = 0; i < slice.count; ++i) {
+        const double coordinates[3] = { slice.vertices[i].s, slice.vertices[i].t, slice.vertices[i].p };
+        for (int j = 0; j < 3; ++j) {
+            min[j] = std::min(min[j], coordinates[j]);
+            max[j] = std::max(max[j], coordinates[j]);
+        }
     }
+}
+
+/**
+ * Describes the edges of a volume for `SliceKernel`.
+ *
+ * Edges are oriented from back to front, and edges parallel to the slices are set up so they are never crossed.
+ *
+ * @param points Corners of volume in eye space, in the same order as `CORNERS`
+ * @param z Depth of first slice in eye space
+ * @param dz Distance between slices
+ * @param edges Array to store edges in
+ */
+void SlicingVolumeRendererNode::findEdges(const M3d::Vec4 points[8],
+                                          const double z,
+                                          const double dz,
+                                          SliceKernel::Edge edges[12]) {
+    for (int i = 0; i < 12; ++i) {
+
+        // Orient edge from back to front
+        int i1 = EDGES[i][0];
+        int i2 = EDGES[i][1];
+        if (points[i1].z > points[i2].z) {
+            std::swap(i1, i2);
+        }
+        const M3d::Vec4& p1 = points[i1];
+        const M3d::Vec4& p2 = points[i2];
+        const M3d::Vec4& c1 = CORNERS[i1];
+        const M3d::Vec4& c2 = CORNERS[i2];
+
+        // Compute where first slice is along edge and how far each slice steps
+        SliceKernel::Edge& edge = edges[i];
+        const double length = p2.z - p1.z;
+        if (length > 0) {
+            edge.u = (z - p1.z) / length;
+            edge.du = dz / length;
+        } else {
+            edge.u = 2;
+            edge.du = 0;
+        }
+
+        // Store start and change of each component
+        edge.start[SliceKernel::X] = p1.x;
+        edge.start[SliceKernel::Y] = p1.y;
+        edge.start[SliceKernel::S] = c1.x + 0.5;
+        edge.start[SliceKernel::T] = c1.y + 0.5;
+        edge.start[SliceKernel::P] = c1.z + 0.5;
+        edge.delta[SliceKernel::X] = p2.x - p1.x;
+        edge.delta[SliceKernel::Y] = p2.y - p1.y;
+        edge.delta[SliceKernel::S] = c2.x - c1.x;
+        edge.delta[SliceKernel::T] = c2.y - c1.y;
+        edge.delta[SliceKernel::P] = c2.z - c1.z;
+    }
+}
 
-    // Calculate extent
+/**
+ * Determines the minimum and maximum of a set of points.
+ *
+ * @param points Corners of a volume in eye space
+ * @return Minimum and maximum of points, as an `Extent`
+ */
+SlicingVolumeRendererNode::Extent SlicingVolumeRendererNode::findExtent(const M3d::Vec4 points[8]) {
     Extent extent;
     for (int i = 0; i < 3; ++i) {
         extent.min[i] = +std::numeric_limits<double>::infinity();
         extent.max[i] = -std::numeric_limits<double>::infinity();
         for (int j = 0; j < 8; ++j) {
-            const double value = transformedPoints[j][i];
+            const double value = points[j][i];
             extent.min[i] = std::min(extent.min[i], value);
             extent.max[i] = std::max(extent.max[i], value);
         }
     }
-
-    // Return it
     return extent;
 }
 
 /**
- * Computes the model matrix at a node.
+ * Determines the planes of the view frustum in eye space.
  *
- * @param node Node to compute model matrix for
- * @return Model matrix at the node
+ * @param projectionMatrix Current projection matrix
+ * @param planes Array to store left, right, bottom, top, near, and far planes in
  */
-M3d::Mat4 SlicingVolumeRendererNode::getModelMatrix(const RapidGL::Node* node) {
-
-    // Find transform nodes
-    std::stack<RapidGL::TransformNode*> transformNodes;
-    RapidGL::Node* parent = node->getParent();
-    while (parent != NULL) {
-        RapidGL::TransformNode* const transformNode = dynamic_cast<RapidGL::TransformNode*>(parent);
-        if (transformNode != NULL) {
-            transformNodes.push(transformNode);
+void SlicingVolumeRendererNode::findFrustum(const M3d::Mat4& projectionMatrix, M3d::Vec4 planes[6]) {
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            const double w = projectionMatrix[j][3];
+            const double c = projectionMatrix[j][i];
+            planes[i * 2][j] = w + c;
+            planes[i * 2 + 1][j] = w - c;
         }
-        parent = parent->getParent();
     }
+}
 
-    // Accumulate matrices
-    RapidGL::State state;
-    while (!transformNodes.empty()) {
-        RapidGL::TransformNode* const transformNode = transformNodes.top();
-        transformNode->visit(state);
-        transformNodes.pop();
+/**
+ * Determines how to lay an offscreen target holding only slices over the scene so it looks the same as if the
+ * slices had been blended straight into the scene.
+ *
+ * @param equation Blend equation for the mode
+ * @param source Blend factor for the target
+ * @param destination Blend factor for the scene
+ */
+void SlicingVolumeRendererNode::findOverlay(GLenum& equation, GLenum& source, GLenum& destination) const {
+    switch (mode) {
+    case MAXIMUM:
+        equation = GL_MAX;
+        source = GL_ONE;
+        destination = GL_ONE;
+        break;
+    case MINIMUM:
+        equation = GL_MIN;
+        source = GL_ONE;
+        destination = GL_ONE;
+        break;
+    case ADDITIVE:
+        equation = GL_FUNC_ADD;
+        source = GL_ONE;
+        destination = GL_ONE;
+        break;
+    default:
+        equation = GL_FUNC_ADD;
+        source = GL_ONE;
+        destination = GL_ONE_MINUS_SRC_ALPHA;
+        break;
     }
-
-    // Return
-    return state.getModelMatrix();
 }
 
 /**
@@ -157,6 +826,428 @@ Gloop::TextureUnit SlicingVolumeRendererNode::getTextureUnit(VolumeNode* volumeN
     return it->second;
 }
 
+/**
+ * Approximates the angle of a direction without trigonometry.
+ *
+ * @param x X component of direction
+ * @param y Y component of direction
+ * @return Value in [0, 4) that increases counter-clockwise from the positive X axis like the real angle
+ */
+double SlicingVolumeRendererNode::getPseudoAngle(const double x, const double y) {
+    if ((x == 0) && (y == 0)) {
+        return 0;
+    } else if (y >= 0) {
+        return (x >= 0) ? (y / (x + y)) : (1 - (x / (y - x)));
+    } else {
+        return (x < 0) ? (2 - (y / (-x - y))) : (3 + (x / (x - y)));
+    }
+}
+
+/**
+ * Determines how far to move slices through their slabs for a refinement pass.
+ *
+ * Mirrors the bits of the pass number around the binary point, so every pass lands halfway between ones
+ * already taken and any number of passes covers the slab evenly.
+ *
+ * @param pass Index of pass, where the first pass isn't moved at all
+ * @return Fraction of a slab in [-0.5, 0.5)
+ */
+double SlicingVolumeRendererNode::getShift(int pass) {
+    double shift = 0;
+    for (double bit = 0.5; pass > 0; pass >>= 1, bit *= 0.5) {
+        if (pass & 1) {
+            shift += bit;
+        }
+    }
+    return (shift < 0.5) ? shift : (shift - 1);
+}
+
+/**
+ * Checks if volumes are drawn when the node is visited.
+ */
+bool SlicingVolumeRendererNode::isEnabled() const {
+    return enabled;
+}
+
+/**
+ * Checks if one proxy is farther from the viewer than another.
+ *
+ * @param p1 First proxy
+ * @param p2 Second proxy
+ * @return `true` if the center of the first proxy is farther away than the center of the second
+ */
+bool SlicingVolumeRendererNode::isFarther(const Proxy& p1, const Proxy& p2) {
+    return (p1.extent.min.z + p1.extent.max.z) < (p2.extent.min.z + p2.extent.max.z);
+}
+
+/**
+ * Checks if slices of different volumes must be drawn in order of depth.
+ */
+bool SlicingVolumeRendererNode::isOrdered() const {
+    return (mode == COMPOSITE) || (mode == FRONT_TO_BACK);
+}
+
+/**
+ * Writes the vertices of one worker's share of the merged slices into the buffer.
+ *
+ * Each worker takes a contiguous range of placements, so they all write to disjoint parts of the buffer.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void SlicingVolumeRendererNode::loadSlices(const int worker, const int numberOfWorkers) {
+
+    // Find range of placements for this worker
+    const size_t numberOfPlacements = placements.size();
+    const size_t begin = (numberOfPlacements * worker) / numberOfWorkers;
+    const size_t end = (numberOfPlacements * (worker + 1)) / numberOfWorkers;
+    if (begin == end) {
+        return;
+    }
+
+    // Write slices starting from where the first one goes
+    const GLsizei sizeOfVertex = strategy->getSizeOfVertex();
+    GLvoid* ptr = ((GLubyte*) data) + (placements[begin].position * sizeOfVertex);
+    for (size_t i = begin; i < end; ++i) {
+        ptr = strategy->load(*placements[i].slice, ptr);
+    }
+}
+
+/**
+ * Describes each volume for strategies that make slices on the GPU.
+ *
+ * Volumes are put in back-to-front order by their centers, so unlike slices made on the CPU, overlapping
+ * volumes are not interleaved.
+ */
+void SlicingVolumeRendererNode::makeProxies() {
+
+    // Make a translation from the unit cube to texture coordinates
+    M3d::Mat4 cubeToTexture(1);
+    cubeToTexture[3] = M3d::Vec4(0.5, 0.5, 0.5, 1.0);
+
+    proxies.clear();
+    for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+
+        // Transform corners into eye space
+        const M3d::Mat4 modelViewMatrix = viewMatrix * SceneUtility::getModelMatrix(*it);
+        M3d::Vec4 points[8];
+        for (int i = 0; i < 8; ++i) {
+            points[i] = modelViewMatrix * CORNERS[i];
+        }
+
+        // Store what the shader needs to rebuild the slices
+        Proxy proxy;
+        proxy.unit = getTextureUnit(*it).toOrdinal();
+        proxy.count = countSlices(points);
+        proxy.correction = ((GLfloat) numberOfSlices) / proxy.count;
+        proxy.eyeToVolume = cubeToTexture * inverse(modelViewMatrix);
+        proxy.extent = findExtent(points);
+        proxies.push_back(proxy);
+    }
+
+    // Put them in order, unless blending doesn't care
+    if (isOrdered()) {
+        std::sort(proxies.begin(), proxies.end(), &isFarther);
+    }
+}
+
+/**
+ * Makes the blue noise texture used for jittering samples.
+ */
+void SlicingVolumeRendererNode::makeJitterTexture() {
+
+    // Make noise
+    std::vector<unsigned char> noise;
+    BlueNoise::generate(JITTER_SIZE, noise);
+
+    // Load it into a texture that repeats across the screen
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + jitterUnit);
+    glGenTextures(1, &jitterTexture);
+    glBindTexture(GL_TEXTURE_2D, jitterTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, JITTER_SIZE, JITTER_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, &noise[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Splits the volumes that changed into tasks for the workers.
+ *
+ * When there are fewer volumes than workers, each volume is split into ranges of whole batches so a single
+ * volume still spreads across the workers.
+ */
+void SlicingVolumeRendererNode::makeTasks() {
+
+    // Decide how many tasks each volume gets at most
+    int tasksPerVolume = workerPool.getNumberOfWorkers() / ((int) dirtyVolumeNodes.size());
+    if (tasksPerVolume < 1) {
+        tasksPerVolume = 1;
+    }
+
+    // Spread shared planes out while interacting, like the number of slices is scaled down otherwise
+    double step = spacing;
+    if (interacting && (interactiveSlices > 0)) {
+        step = (spacing * numberOfSlices) / interactiveSlices;
+    }
+
+    // Move slices through their slabs for the current refinement pass
+    const double shift = getShift(pass);
+
+    // Make tasks, with everything that walks the scene done here on the render thread
+    tasks.clear();
+    for (std::set<VolumeNode*>::const_iterator it = dirtyVolumeNodes.begin(); it != dirtyVolumeNodes.end(); ++it) {
+        Task task;
+        task.volumeNode = *it;
+        task.unit = getTextureUnit(*it).toOrdinal();
+        task.modelViewMatrix = viewMatrix * SceneUtility::getModelMatrix(*it);
+        task.occupancyGrid = NULL;
+        task.brickCache = (*it)->getBrickCache();
+        const std::vector<float>& opacities = (*it)->getOpacities();
+        if (!opacities.empty() && (task.brickCache != NULL)) {
+            task.visible.assign(opacities.size() + 1, 0);
+            for (size_t i = 0; i < opacities.size(); ++i) {
+                task.visible[i + 1] = task.visible[i] + (opacities[i] > 0);
+            }
+        } else if (!opacities.empty()) {
+            OccupancyGrid& occupancyGrid = (*it)->getOccupancyGrid();
+            if (occupancyGrid.isBuilt()) {
+                task.occupancyGrid = &occupancyGrid;
+            }
+        }
+
+        // Decide how many slices the volume gets and where they go, with each centered in its slab
+        M3d::Vec4 points[8];
+        for (int i = 0; i < 8; ++i) {
+            points[i] = task.modelViewMatrix * CORNERS[i];
+        }
+        const Extent extent = findExtent(points);
+        if (spacing > 0) {
+            task.plane = (int) floor((-extent.min.z / step) - 0.5);
+            const int front = std::max(0, (int) ceil((-extent.max.z / step) - 0.5));
+            task.count = task.plane - front + 1;
+            if (task.count <= 0) {
+                continue;
+            }
+            task.dz = step;
+            task.z = -(task.plane + 0.5 - shift) * step;
+            task.correction = (GLfloat) ((numberOfSlices * step) / (extent.max.z - extent.min.z));
+        } else {
+            task.count = countSlices(points);
+            if (task.count == 0) {
+                continue;
+            }
+            task.dz = (extent.max.z - extent.min.z) / task.count;
+            task.z = extent.min.z + (task.dz * (0.5 + shift));
+            task.plane = task.count - 1;
+            task.correction = ((GLfloat) numberOfSlices) / task.count;
+        }
+
+        // Split them into ranges of whole batches
+        const int numberOfBatches = (task.count + SliceKernel::BATCH_SIZE - 1) / SliceKernel::BATCH_SIZE;
+        const int numberOfTasks = std::min(tasksPerVolume, numberOfBatches);
+        const int slicesPerTask = ((numberOfBatches + numberOfTasks - 1) / numberOfTasks) * SliceKernel::BATCH_SIZE;
+        for (int begin = 0; begin < task.count; begin += slicesPerTask) {
+            task.begin = begin;
+            task.end = std::min(begin + slicesPerTask, task.count);
+            tasks.push_back(task);
+        }
+    }
+}
+
+/**
+ * Merges the slices of each volume into one back-to-front stream.
+ *
+ * Since the slices of each volume are already in order, the next slice to draw is always at the front of one
+ * of the volumes' lists, so a small heap holding one cursor per volume is enough.  When volumes share planes
+ * the heap isn't needed at all, since each plane can just take its slices from every volume in turn, and in
+ * modes where order doesn't matter each volume's slices are simply drawn one volume after another.
+ *
+ * @return Total number of vertices in all the slices
+ */
+GLsizei SlicingVolumeRendererNode::merge() {
+
+    runs.clear();
+    firsts.clear();
+    counts.clear();
+    placements.clear();
+    GLint position = 0;
+
+    // Keep each volume's slices together if blending doesn't depend on order
+    if (!isOrdered()) {
+        for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+            const std::vector<Slice>& slicesOfVolume = slicesByVolumeNode[*it];
+            typedef std::vector<Slice>::const_iterator iterator_t;
+            for (iterator_t slice = slicesOfVolume.begin(); slice != slicesOfVolume.end(); ++slice) {
+                place(*slice, position);
+            }
+        }
+        return position;
+    }
+
+    // Walk shared planes from back to front, taking every volume's slices on each plane
+    if (spacing > 0) {
+        std::vector<Cursor> cursors;
+        int plane = -1;
+        for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+            const std::vector<Slice>& slicesOfVolume = slicesByVolumeNode[*it];
+            if (!slicesOfVolume.empty()) {
+                cursors.push_back(Cursor(slicesOfVolume));
+                plane = std::max(plane, slicesOfVolume.front().plane);
+            }
+        }
+        while (plane >= 0) {
+            int next = -1;
+            for (std::vector<Cursor>::iterator it = cursors.begin(); it != cursors.end(); ++it) {
+                while ((it->slice != it->end) && (it->slice->plane == plane)) {
+                    place(*(it->slice), position);
+                    ++(it->slice);
+                }
+                if (it->slice != it->end) {
+                    next = std::max(next, it->slice->plane);
+                }
+            }
+            plane = next;
+        }
+        return position;
+    }
+
+    // Start a cursor at the back of each volume
+    std::priority_queue<Cursor,std::vector<Cursor>,std::greater<Cursor> > cursors;
+    for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+        const std::vector<Slice>& slicesOfVolume = slicesByVolumeNode[*it];
+        if (!slicesOfVolume.empty()) {
+            cursors.push(Cursor(slicesOfVolume));
+        }
+    }
+
+    // Repeatedly take the farthest slice
+    while (!cursors.empty()) {
+        Cursor cursor = cursors.top();
+        cursors.pop();
+        place(*cursor.slice, position);
+        ++cursor.slice;
+        if (cursor.slice != cursor.end) {
+            cursors.push(cursor);
+        }
+    }
+    return position;
+}
+
+/**
+ * Marks the volumes below a transform node as needing new slices, and notes that something moved.
+ *
+ * A volume node itself changes when its opacities or texture do, which only needs that volume to be sliced
+ * again and the strategy to be told about it.  A node of the rest of the scene restarts refinement like any
+ * other move, and needs every volume to be sliced again when stopping at the scene's depth, since the depth
+ * grid is only rebuilt when something is.
+ *
+ * @param node Transform node, volume node, or node of the rest of the scene that changed
+ */
+void SlicingVolumeRendererNode::nodeChanged(RapidGL::Node* node) {
+    typedef std::multimap<RapidGL::Node*,VolumeNode*>::const_iterator iterator_t;
+    const std::pair<iterator_t,iterator_t> range = volumeNodesByTransformNode.equal_range(node);
+    for (iterator_t it = range.first; it != range.second; ++it) {
+        dirtyVolumeNodes.insert(it->second);
+    }
+
+    // Re-slice everything against the new depth if the opaque scene may have changed
+    if ((depthUnit >= 0) && (sceneNodes.count(node) > 0)) {
+        dirtyVolumeNodes.insert(volumeNodes.begin(), volumeNodes.end());
+    }
+
+    // Re-slice a volume whose opacities or texture changed, but don't count it as moving
+    VolumeNode* const volumeNode = dynamic_cast<VolumeNode*>(node);
+    if (volumeNode != NULL) {
+        dirtyVolumeNodes.insert(volumeNode);
+        changedVolumeNodes.insert(volumeNode);
+    } else {
+        moved = true;
+    }
+}
+
+/**
+ * Listens to the nodes the rest of the scene depends on, which hides the volumes and shows through them.
+ *
+ * Those are every transform or framebuffer node that's neither below the renderer nor already observed for
+ * the volumes, which covers the geometry drawn before the volumes, and the texture node holding the depth of
+ * the scene if there is one.
+ *
+ * @param textureNode Texture node holding the depth of the scene, or `NULL` if not stopping at the scene
+ */
+void SlicingVolumeRendererNode::observeScene(RapidGL::TextureNode* const textureNode) {
+
+    // Find candidates anywhere in the scene
+    RapidGL::Node* const root = RapidGL::findRoot(this);
+    std::vector<RapidGL::Node*> nodes;
+    if (textureNode != NULL) {
+        nodes.push_back(textureNode);
+    }
+    const std::vector<RapidGL::TransformNode*> transformNodes =
+            SceneUtility::findDescendants<RapidGL::TransformNode>(root);
+    nodes.insert(nodes.end(), transformNodes.begin(), transformNodes.end());
+    const std::vector<RapidGL::FramebufferNode*> framebufferNodes =
+            SceneUtility::findDescendants<RapidGL::FramebufferNode>(root);
+    nodes.insert(nodes.end(), framebufferNodes.begin(), framebufferNodes.end());
+
+    // Listen to those not below the renderer or above a volume
+    for (std::vector<RapidGL::Node*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        RapidGL::Node* node = *it;
+        if ((sceneNodes.count(node) > 0) || (volumeNodesByTransformNode.count(node) > 0)) {
+            continue;
+        }
+        while ((node != NULL) && (node != this)) {
+            node = node->getParent();
+        }
+        if (node == NULL) {
+            (*it)->addNodeListener(this);
+            sceneNodes.insert(*it);
+        }
+    }
+}
+
+/**
+ * Puts a slice after the last one placed.
+ *
+ * Runs of slices sharing a texture unit are recorded as they go by, along with the first vertex and count of
+ * each slice's fan so a whole run can be drawn with one call.  Where each slice goes in the buffer is
+ * recorded so the slices can be written out in parallel afterwards.
+ *
+ * @param slice Slice to place
+ * @param position Vertex the slice starts at, which is moved past it
+ */
+void SlicingVolumeRendererNode::place(const Slice& slice, GLint& position) {
+
+    // Note where it goes
+    Placement placement;
+    placement.slice = &slice;
+    placement.position = position;
+    placements.push_back(placement);
+
+    // Add it to the current run, or start a new one if the unit, correction, or offset changed
+    if (runs.empty()
+            || (runs.back().unit != slice.unit)
+            || (runs.back().correction != slice.correction)
+            || !std::equal(slice.offset, slice.offset + 3, runs.back().offset)) {
+        Run run;
+        run.unit = slice.unit;
+        run.correction = slice.correction;
+        std::copy(slice.offset, slice.offset + 3, run.offset);
+        run.first = firsts.size();
+        run.count = 0;
+        runs.push_back(run);
+    }
+    const GLsizei count = countVertices(slice);
+    firsts.push_back(position);
+    counts.push_back(count);
+    ++runs.back().count;
+    position += count;
+}
+
 /**
  * Sets up the renderer.
  */
@@ -180,7 +1271,7 @@ void SlicingVolumeRendererNode::preVisit(RapidGL::State& state) {
     }
 
     // Find volume nodes
-    volumeNodes = findDescendants<VolumeNode>(this);
+    volumeNodes = SceneUtility::findDescendants<VolumeNode>(this);
     if (volumeNodes.empty()) {
         throw std::runtime_error("[SlicingVolumeRendererNode] Could not find any volume nodes!");
     }
@@ -188,6 +1279,16 @@ void SlicingVolumeRendererNode::preVisit(RapidGL::State& state) {
     // Store texture units
     for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
         VolumeNode* const volumeNode = *it;
+        if ((mode == FRONT_TO_BACK) && strategy->usesProxies()) {
+            throw std::runtime_error("[SlicingVolumeRendererNode] Strategy can't draw slices front to back!");
+        }
+        if ((volumeNode->getBrickCache() != NULL) && strategy->usesProxies()) {
+            throw std::runtime_error("[SlicingVolumeRendererNode] Strategy can't slice volumes streamed in bricks!");
+        }
+        if (volumeNode->getUnit() >= 0) {
+            putTextureUnit(volumeNode, Gloop::TextureUnit::fromOrdinal(volumeNode->getUnit()));
+            continue;
+        }
         const std::string textureId = volumeNode->getTextureId();
         RapidGL::TextureNode* textureNode = RapidGL::findAncestor<RapidGL::TextureNode>(this, textureId);
         if (textureNode == NULL) {
@@ -196,40 +1297,392 @@ void SlicingVolumeRendererNode::preVisit(RapidGL::State& state) {
         putTextureUnit(volumeNode, textureNode->getTextureUnit());
     }
 
+    // Observe each volume and the transform nodes above it
+    for (std::vector<VolumeNode*>::const_iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
+        VolumeNode* const volumeNode = *it;
+        RapidGL::Node* node = volumeNode->getParent();
+        while (node != NULL) {
+            RapidGL::TransformNode* const transformNode = dynamic_cast<RapidGL::TransformNode*>(node);
+            if (transformNode != NULL) {
+                if (volumeNodesByTransformNode.count(transformNode) == 0) {
+                    transformNode->addNodeListener(this);
+                }
+                volumeNodesByTransformNode.insert(std::make_pair(transformNode, volumeNode));
+            }
+            node = node->getParent();
+        }
+        volumeNode->addNodeListener(this);
+        dirtyVolumeNodes.insert(volumeNode);
+    }
+
     // Get program
     const Gloop::Program program = programNode->getProgram();
 
     // Find uniform locations
     strategy->findUniformLocations(program);
 
+    // Let the strategy prepare the volumes' textures
+    strategy->setUpVolumes(textureUnitsByVolumeNode);
+
+    // Find texture holding depth of the scene
+    RapidGL::TextureNode* depthNode = NULL;
+    if (!depthId.empty()) {
+        depthNode = RapidGL::findAncestor<RapidGL::TextureNode>(this, depthId);
+        if (depthNode == NULL) {
+            throw std::runtime_error("[SlicingVolumeRendererNode] Could not find depth texture node!");
+        }
+        depthUnit = depthNode->getTextureUnit().toOrdinal();
+    }
+
+    // Watch the rest of the scene if slices are trimmed to its depth or averaged over it
+    if ((depthNode != NULL) || (passes > 1)) {
+        observeScene(depthNode);
+    }
+
+    // Make noise for jittering samples
+    if (jitterUnit >= 0) {
+        jitterLocation = program.uniformLocation("JitterTexture");
+        makeJitterTexture();
+    }
+
     // Bind
     vao.bind();
-    arrayBuffer.bind(vbo);
+    streamingBuffer.bind();
 
-    // Allocate buffer
-    const GLsizei sizeOfQuad = strategy->getSizeOfQuad();
-    const GLsizei sizeOfBuffer = sizeOfQuad * numberOfSlices * volumeNodes.size();
-    arrayBuffer.data(sizeOfBuffer, NULL, GL_STREAM_DRAW);
+    // Allocate buffer with room for every slice in each region, unless slices are made on the GPU
+    const GLsizei sizeOfSlice = strategy->getSizeOfVertex() * MAX_VERTICES_PER_SLICE;
+    const GLsizei sizeOfRegion = sizeOfSlice * numberOfSlices * volumeNodes.size();
+    if ((sizeOfRegion > 0) && !strategy->usesProxies()) {
+        streamingBuffer.allocate(sizeOfRegion);
+    }
 
     // Set up attributes
     strategy->setUpAttributes(programNode, vao);
 
     // Unbind VAO
-    arrayBuffer.unbind(vbo);
+    streamingBuffer.unbind();
     vao.unbind();
 
-    // Now ready
-    ready = true;
-}
+    // Now ready
+    ready = true;
+}
+
+/**
+ * Stores a texture unit by its volume node.
+ *
+ * @param volumeNode Volume node
+ * @param textureUnit Texture unit to use for volume node
+ */
+void SlicingVolumeRendererNode::putTextureUnit(VolumeNode* volumeNode, const Gloop::TextureUnit& textureUnit) {
+    textureUnitsByVolumeNode.insert(std::pair<VolumeNode*,Gloop::TextureUnit>(volumeNode, textureUnit));
+}
+
+/**
+ * Reads back the depth of the scene and rebuilds the grid from it.
+ *
+ * The depth texture must be bound to its texture unit, which its texture node does before visiting the
+ * renderer.  Reading it stalls until the earlier pass is finished, so it's only done when slicing again.
+ */
+void SlicingVolumeRendererNode::readDepth() {
+
+    // Switch to unit
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + depthUnit);
+
+    // Read the texture
+    GLint width, height;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    if ((width > 0) && (height > 0)) {
+        depths.resize(width * height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &depths[0]);
+        depthGrid.build(&depths[0], width, height);
+    }
+
+    // Restore unit
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Asks the caches of volumes streamed in bricks for the bricks their new slices crossed.
+ *
+ * Bricks are asked for from front to back, so the nearest ones arrive first.
+ */
+void SlicingVolumeRendererNode::requestBricks() {
+    std::map<BrickCache*,std::set<int> > seenByBrickCache;
+    std::map<BrickCache*,std::vector<int> > bricksByBrickCache;
+    for (std::vector<Task>::const_reverse_iterator it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        if (it->brickCache == NULL) {
+            continue;
+        }
+        std::set<int>& seen = seenByBrickCache[it->brickCache];
+        std::vector<int>& bricks = bricksByBrickCache[it->brickCache];
+        for (std::vector<int>::const_reverse_iterator b = it->bricks.rbegin(); b != it->bricks.rend(); ++b) {
+            if (seen.insert(*b).second) {
+                bricks.push_back(*b);
+            }
+        }
+    }
+    typedef std::map<BrickCache*,std::vector<int> >::const_iterator iterator_t;
+    for (iterator_t it = bricksByBrickCache.begin(); it != bricksByBrickCache.end(); ++it) {
+        it->first->request(it->second);
+    }
+}
+
+/**
+ * Puts the slices placed by `merge` in the opposite order.
+ */
+void SlicingVolumeRendererNode::reverse() {
+    std::vector<Placement> backToFront;
+    backToFront.swap(placements);
+    runs.clear();
+    firsts.clear();
+    counts.clear();
+    GLint position = 0;
+    typedef std::vector<Placement>::const_reverse_iterator iterator_t;
+    for (iterator_t it = backToFront.rbegin(); it != backToFront.rend(); ++it) {
+        place(*(it->slice), position);
+    }
+}
+
+/**
+ * Changes whether volumes are drawn when the node is visited.
+ *
+ * @param enabled `true` to draw volumes
+ */
+void SlicingVolumeRendererNode::setEnabled(const bool enabled) {
+    this->enabled = enabled;
+}
+
+/**
+ * Makes the slices of each task assigned to a worker.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+void SlicingVolumeRendererNode::sliceTasks(const int worker, const int numberOfWorkers) {
+    for (size_t i = worker; i < tasks.size(); i += numberOfWorkers) {
+        sliceVolume(tasks[i]);
+    }
+}
+
+/**
+ * Cuts a range of slices out of a volume.
+ *
+ * Only reads from the node, so several tasks can be worked on at once.
+ *
+ * @param task Task describing volume and range of slices, which receives the slices in back-to-front order
+ */
+void SlicingVolumeRendererNode::sliceVolume(Task& task) const {
+
+    // Transform corners into eye space
+    M3d::Vec4 points[8];
+    for (int i = 0; i < 8; ++i) {
+        points[i] = task.modelViewMatrix * CORNERS[i];
+    }
+    const double dz = task.dz;
+    const double z = task.z;
+
+    // Describe edges for kernel
+    SliceKernel::Edge edges[SliceKernel::NUMBER_OF_EDGES];
+    findEdges(points, z, dz, edges);
+
+    // Find step from a slice to the one behind it in texture coordinates
+    const M3d::Vec4 step = inverse(task.modelViewMatrix) * M3d::Vec4(0, 0, -dz, 0);
+    const GLfloat offset[3] = { (GLfloat) step.x, (GLfloat) step.y, (GLfloat) step.z };
+
+    // Make slices a batch at a time
+    SliceKernel::Batch batch;
+    std::vector<Slice> pieces;
+    for (int start = task.begin; start < task.end; start += SliceKernel::BATCH_SIZE) {
+
+        // Find where the slices cross the edges
+        const int remaining = task.end - start;
+        const int count = (remaining < SliceKernel::BATCH_SIZE) ? remaining : SliceKernel::BATCH_SIZE;
+        SliceKernel::compute(edges, start, count, batch);
+
+        for (int k = 0; k < count; ++k) {
+
+            // Make slice
+            Slice slice;
+
+            // Set texture unit, opacity correction, and step to the next slice
+            slice.unit = task.unit;
+            slice.correction = task.correction;
+            std::copy(offset, offset + 3, slice.offset);
+
+            // Compute Z coordinate of slice and which plane it's on
+            slice.z = z + (dz * (start + k));
+            slice.plane = task.plane - (start + k);
+
+            // Cut the volume with the slice, then trim to what is visible
+            slice.count = assemble(batch, k, slice.vertices);
+            if ((slice.count >= 3) && (task.occupancyGrid != NULL) && !clip(slice, *task.occupancyGrid)) {
+                continue;
+            }
+
+            // Store slice, or the pieces of it in bricks that are loaded
+            if (task.brickCache == NULL) {
+                clip(slice, frustum);
+                if ((slice.count >= 3) && clip(slice, depthGrid, projectionMatrix)) {
+                    task.slices.push_back(slice);
+                }
+            } else if (slice.count >= 3) {
+                pieces.clear();
+                split(slice, *task.brickCache, task.visible, pieces, task.bricks);
+                for (std::vector<Slice>::iterator piece = pieces.begin(); piece != pieces.end(); ++piece) {
+                    clip(*piece, frustum);
+                    if ((piece->count >= 3) && clip(*piece, depthGrid, projectionMatrix)) {
+                        task.slices.push_back(*piece);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Cuts a slice of a volume streamed in bricks into pieces along the bricks it crosses.
+ *
+ * Pieces are moved to where their brick is in the atlas, and pieces in bricks that aren't loaded yet are
+ * left out.  Since the pieces of a slice don't overlap, they can be drawn in any order.  Bricks read before
+ * whose values all have zero opacity are skipped without being noted, so they aren't asked for again.
+ *
+ * @param slice Slice to cut, in texture coordinates of the volume
+ * @param brickCache Cache holding the bricks of the volume
+ * @param visible Number of values below each value with non-zero opacity, or empty to keep every brick
+ * @param pieces Vector to add pieces to
+ * @param bricks Vector to add the index of every brick the slice crosses to
+ */
+void SlicingVolumeRendererNode::split(const Slice& slice,
+                                      const BrickCache& brickCache,
+                                      const std::vector<int>& visible,
+                                      std::vector<Slice>& pieces,
+                                      std::vector<int>& bricks) {
+
+    // Find range of bricks around slice
+    double min[3];
+    double max[3];
+    findBox(slice, min, max);
+    int first[3];
+    int last[3];
+    for (int i = 0; i < 3; ++i) {
+        first[i] = brickCache.findBrick(i, min[i]);
+        last[i] = brickCache.findBrick(i, max[i]);
+    }
+
+    // Cut into columns, then rows, then bricks
+    Slice column, row, piece;
+    double scale[3], offset[3];
+    for (int x = first[0]; x <= last[0]; ++x) {
+        if (!clip(slice, 0, brickCache.getBrickStart(0, x), brickCache.getBrickStart(0, x + 1), column)) {
+            continue;
+        }
+        for (int y = first[1]; y <= last[1]; ++y) {
+            if (!clip(column, 1, brickCache.getBrickStart(1, y), brickCache.getBrickStart(1, y + 1), row)) {
+                continue;
+            }
+            for (int z = first[2]; z <= last[2]; ++z) {
+                if (!clip(row, 2, brickCache.getBrickStart(2, z), brickCache.getBrickStart(2, z + 1), piece)) {
+                    continue;
+                }
+
+                // Skip brick if it can't be seen
+                const int brick = brickCache.getIndex(x, y, z);
+                int minimum, maximum;
+                if (!visible.empty()
+                        && brickCache.findRange(brick, minimum, maximum)
+                        && (visible[maximum + 1] == visible[minimum])) {
+                    continue;
+                }
+
+                // Note brick, and keep piece if the brick is loaded
+                bricks.push_back(brick);
+                if (!brickCache.findTransform(brick, scale, offset)) {
+                    continue;
+                }
+                for (int i = 0; i < piece.count; ++i) {
+                    Vertex& v = piece.vertices[i];
+                    v.s = (v.s * scale[0]) + offset[0];
+                    v.t = (v.t * scale[1]) + offset[1];
+                    v.p = (v.p * scale[2]) + offset[2];
+                }
+                for (int i = 0; i < 3; ++i) {
+                    piece.offset[i] = (GLfloat) (slice.offset[i] * scale[i]);
+                }
+                pieces.push_back(piece);
+            }
+        }
+    }
+}
+
+/**
+ * Packs a texture coordinate into an unsigned short, as the vertex formats store them.
+ *
+ * @param coordinate Texture coordinate, which is clamped to [0, 1]
+ * @return Coordinate scaled to the range of an unsigned short
+ */
+GLushort SlicingVolumeRendererNode::toNormalized(const double coordinate) {
+    const double clamped = (coordinate < 0) ? 0 : ((coordinate > 1) ? 1 : coordinate);
+    return (GLushort) ((clamped * 65535) + 0.5);
+}
+
+/**
+ * Re-slices volumes that changed and loads all the slices into the buffer.
+ */
+void SlicingVolumeRendererNode::update() {
+
+    // Find view frustum, and where the scene hides things if slicing stops at it
+    findFrustum(projectionMatrix, frustum);
+    if (depthUnit >= 0) {
+        readDepth();
+    }
+
+    // Re-slice volumes that changed on the workers
+    makeTasks();
+    workerPool.run(this, &SlicingVolumeRendererNode::sliceTasks);
+
+    // Gather slices of each volume, which were split into tasks in order
+    for (std::set<VolumeNode*>::const_iterator it = dirtyVolumeNodes.begin(); it != dirtyVolumeNodes.end(); ++it) {
+        slicesByVolumeNode[*it].clear();
+    }
+    for (std::vector<Task>::const_iterator it = tasks.begin(); it != tasks.end(); ++it) {
+        std::vector<Slice>& slicesOfVolume = slicesByVolumeNode[it->volumeNode];
+        slicesOfVolume.insert(slicesOfVolume.end(), it->slices.begin(), it->slices.end());
+    }
+    requestBricks();
+    tasks.clear();
+    dirtyVolumeNodes.clear();
+
+    // Put slices from all volumes in order, flipping it if compositing front to back
+    const GLsizei count = merge();
+    if (mode == FRONT_TO_BACK) {
+        reverse();
+    }
+
+    // Skip if nothing to load
+    if (count == 0) {
+        return;
+    }
+
+    // Make room if volumes streamed in bricks were cut into more pieces than the buffer holds
+    const GLsizei sizeOfVertex = strategy->getSizeOfVertex();
+    if ((count * sizeOfVertex) > streamingBuffer.getSizeOfRegion()) {
+        streamingBuffer.allocate(count * sizeOfVertex * 2);
+    }
+
+    // Write slices straight into the next free region of the buffer on the workers
+    data = streamingBuffer.map(count * sizeOfVertex);
+    workerPool.run(this, &SlicingVolumeRendererNode::loadSlices);
+    const GLint first = streamingBuffer.unmap() / sizeOfVertex;
+    data = NULL;
 
-/**
- * Stores a texture unit by its volume node.
- *
- * @param volumeNode Volume node
- * @param textureUnit Texture unit to use for volume node
- */
-void SlicingVolumeRendererNode::putTextureUnit(VolumeNode* volumeNode, const Gloop::TextureUnit& textureUnit) {
-    textureUnitsByVolumeNode.insert(std::pair<VolumeNode*,Gloop::TextureUnit>(volumeNode, textureUnit));
+    // Move each slice to where its region starts
+    for (std::vector<GLint>::iterator it = firsts.begin(); it != firsts.end(); ++it) {
+        (*it) += first;
+    }
 }
 
 /**
@@ -237,75 +1690,115 @@ void SlicingVolumeRendererNode::putTextureUnit(VolumeNode* volumeNode, const Glo
  */
 void SlicingVolumeRendererNode::visit(RapidGL::State& state) {
 
-    // Get view matrix
+    // Skip if turned off
+    if (!enabled) {
+        return;
+    }
+
+    // Re-slice everything if the view changed
     const M3d::Mat4 viewMatrix = state.getViewMatrix();
+    const M3d::Mat4 projectionMatrix = state.getProjectionMatrix();
+    if (!equals(viewMatrix, this->viewMatrix) || !equals(projectionMatrix, this->projectionMatrix)) {
+        this->viewMatrix = viewMatrix;
+        this->projectionMatrix = projectionMatrix;
+        dirtyVolumeNodes.insert(volumeNodes.begin(), volumeNodes.end());
+        moved = true;
+    }
 
-    // Make quads
-    std::vector<Quad> quads;
+    // Use fewer slices while things move, then refine everything once they settle, keeping shared planes the
+    // same for every volume
+    if (moved) {
+        moved = false;
+        if (!interacting && (spacing > 0)) {
+            dirtyVolumeNodes.insert(volumeNodes.begin(), volumeNodes.end());
+        }
+        interacting = true;
+        lastMove.update();
+    } else if (interacting && lastMove.isElapsed(REFINE_DELAY)) {
+        interacting = false;
+        dirtyVolumeNodes.insert(volumeNodes.begin(), volumeNodes.end());
+    }
 
-    for (std::vector<VolumeNode*>::iterator it = volumeNodes.begin(); it != volumeNodes.end(); ++it) {
-        VolumeNode* const volumeNode = *it;
+    // Start refining over again whenever slices change for any other reason, or move on to the next pass
+    const bool refining = (passes > 1) && !interacting && !strategy->usesProxies();
+    if (!refining || !dirtyVolumeNodes.empty()) {
+        pass = 0;
+        accumulator.reset();
+    } else if (pass < passes) {
+        dirtyVolumeNodes.insert(volumeNodes.begin(), volumeNodes.end());
+    }
 
-        // Get texture unit
-        const Gloop::TextureUnit textureUnit = getTextureUnit(volumeNode);
-
-        // Find extent
-        const Extent extent = findExtent(volumeNode, viewMatrix);
-        const double dz = (extent.max.z - extent.min.z) / numberOfSlices;
-
-        // Calculate inverse model view matrix
-        const M3d::Mat4 modelMatrix = getModelMatrix(volumeNode);
-        const M3d::Mat4 modelViewMatrix = viewMatrix * modelMatrix;
-        const M3d::Mat4 inverseModelViewMatrix = M3d::inverse(modelViewMatrix);
-
-        for (int i = 0; i < numberOfSlices; ++i) {
-
-            // Make quad
-            Quad quad;
-
-            // Set texture unit
-            quad.unit = textureUnit.toOrdinal();
-
-            // Compute Z coordinate of quad
-            quad.z = extent.min.z + (dz * i);
-
-            // Store points of quad
-            quad.v0.x = extent.max.x;
-            quad.v0.y = extent.max.y;
-            quad.v1.x = extent.min.x;
-            quad.v1.y = extent.max.y;
-            quad.v2.x = extent.min.x;
-            quad.v2.y = extent.min.y;
-            quad.v3.x = extent.max.x;
-            quad.v3.y = extent.min.y;
-
-            // Compute texture coordinates
-            for (int j = 0; j < 4; ++j) {
-                Vertex* const v = &(quad[j]);
-                const M3d::Vec4 p1(v->x, v->y, quad.z, 1);
-                const M3d::Vec4 p2 = inverseModelViewMatrix * p1;
-                v->s = p2.x + 0.5;
-                v->t = p2.y + 0.5;
-                v->p = p2.z + 0.5;
-            }
+    // Tell the strategy about volumes whose textures may have changed
+    typedef std::set<VolumeNode*>::const_iterator iterator_t;
+    for (iterator_t it = changedVolumeNodes.begin(); it != changedVolumeNodes.end(); ++it) {
+        strategy->volumeChanged(getTextureUnit(*it).toOrdinal());
+    }
+    changedVolumeNodes.clear();
+
+    // Find size of viewport for sizing slices
+    if (!dirtyVolumeNodes.empty()) {
+        glGetIntegerv(GL_VIEWPORT, viewport);
+    }
 
-            // Store quad
-            quads.push_back(quad);
+    // Bind noise for jittering samples
+    if (jitterUnit >= 0) {
+        GLint activeTexture;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+        glActiveTexture(GL_TEXTURE0 + jitterUnit);
+        glBindTexture(GL_TEXTURE_2D, jitterTexture);
+        glActiveTexture(activeTexture);
+        glUniform1i(jitterLocation, jitterUnit);
+    }
+
+    // Let the GPU make the slices if the strategy can
+    if (strategy->usesProxies()) {
+        if (!dirtyVolumeNodes.empty()) {
+            makeProxies();
+            dirtyVolumeNodes.clear();
         }
+        vao.bind();
+        const Depth depth = beginDepth();
+        draw(false);
+        endDepth(depth);
+        vao.unbind();
+        return;
     }
 
-    // Sort the quads
-    std::sort(quads.begin(), quads.end(), &compare);
+    // Just lay the average over the scene once every pass is in
+    GLenum equation, source, destination;
+    findOverlay(equation, source, destination);
+    if (refining && (pass == passes)) {
+        accumulator.present(equation, source, destination);
+        return;
+    }
 
     // Bind
     vao.bind();
-    arrayBuffer.bind(vbo);
+    streamingBuffer.bind();
+
+    // Update the buffer if anything moved, otherwise reuse what's already there
+    if (!dirtyVolumeNodes.empty()) {
+        update();
+    }
 
-    // Draw quads
-    strategy->draw(quads);
+    // Draw slices, then fence off the region until the GPU is done with them
+    if (refining) {
+        accumulator.begin((mode == MINIMUM) ? 1.0f : 0.0f);
+    }
+    if (!runs.empty()) {
+        const Depth depth = beginDepth();
+        draw(refining);
+        endDepth(depth);
+        streamingBuffer.fence();
+    }
+    if (refining) {
+        accumulator.end();
+        accumulator.present(equation, source, destination);
+        ++pass;
+    }
 
     // Unbind
-    arrayBuffer.unbind(vbo);
+    streamingBuffer.unbind();
     vao.unbind();
 }
 
@@ -317,63 +1810,53 @@ SlicingVolumeRendererNode::AttributeStrategy::AttributeStrategy() {
     // empty
 }
 
-void SlicingVolumeRendererNode::AttributeStrategy::draw(const std::vector<Quad>& quads) {
-
-    const Gloop::BufferTarget arrayBuffer = Gloop::BufferTarget::arrayBuffer();
-
-    const int floatsPerBuffer = FLOATS_PER_QUAD * quads.size();
-    GLfloat data[floatsPerBuffer];
-
-    // Draw the quads
-    int count = 0;
-    for (std::vector<Quad>::const_iterator it = quads.begin(); it != quads.end(); ++it) {
-
-        int p = count * FLOATS_PER_QUAD;
-
-        /* upper right */
-        data[p++] = it->v0.x; data[p++] = it->v0.y; data[p++] = it->z;
-        data[p++] = it->v0.s; data[p++] = it->v0.t; data[p++] = it->v0.p;
-        data[p++] = it->unit;
+void SlicingVolumeRendererNode::AttributeStrategy::draw(const std::vector<Run>& runs,
+                                                        const std::vector<GLint>& firsts,
+                                                        const std::vector<GLsizei>& counts) {
+    if (!runs.empty()) {
+        const GLint first = runs.front().first;
+        const GLsizei count = runs.back().first + runs.back().count - first;
+        glMultiDrawArrays(GL_TRIANGLE_FAN, &firsts[first], &counts[first], count);
+    }
+}
 
-        /* upper left */
-        data[p++] = it->v1.x; data[p++] = it->v1.y; data[p++] = it->z;
-        data[p++] = it->v1.s; data[p++] = it->v1.t; data[p++] = it->v1.p;
-        data[p++] = it->unit;
+void SlicingVolumeRendererNode::AttributeStrategy::draw(const std::vector<Proxy>& proxies) {
+    throw std::logic_error("[SlicingVolumeRendererNode] Attribute strategy does not draw proxies!");
+}
 
-        /* lower left */
-        data[p++] = it->v2.x; data[p++] = it->v2.y; data[p++] = it->z;
-        data[p++] = it->v2.s; data[p++] = it->v2.t; data[p++] = it->v2.p;
-        data[p++] = it->unit;
+void SlicingVolumeRendererNode::AttributeStrategy::findUniformLocations(const Gloop::Program& program) {
+    // empty
+}
 
-        /* lower left */
-        data[p++] = it->v2.x; data[p++] = it->v2.y; data[p++] = it->z;
-        data[p++] = it->v2.s; data[p++] = it->v2.t; data[p++] = it->v2.p;
-        data[p++] = it->unit;
+GLsizei SlicingVolumeRendererNode::AttributeStrategy::getSizeOfVertex() {
+    return SIZE_OF_VERTEX;
+}
 
-        /* lower right */
-        data[p++] = it->v3.x; data[p++] = it->v3.y; data[p++] = it->z;
-        data[p++] = it->v3.s; data[p++] = it->v3.t; data[p++] = it->v3.p;
-        data[p++] = it->unit;
+GLvoid* SlicingVolumeRendererNode::AttributeStrategy::load(const Slice& slice, GLvoid* const ptr) {
 
-        /* upper right */
-        data[p++] = it->v0.x; data[p++] = it->v0.y; data[p++] = it->z;
-        data[p++] = it->v0.s; data[p++] = it->v0.t; data[p++] = it->v0.p;
-        data[p++] = it->unit;
+    Packed* data = (Packed*) ptr;
 
-        ++count;
-    }
-    if (count > 0) {
-        arrayBuffer.subData(0, count * SIZE_OF_QUAD, data);
-        glDrawArrays(GL_TRIANGLES, 0, count * VERTICES_PER_QUAD);
+    // Load the slice as a triangle fan
+    for (int i = 0; i < slice.count; ++i) {
+        data = loadVertex(data, slice.vertices[i], slice.z, slice.unit, slice.correction);
     }
+    return data;
 }
 
-void SlicingVolumeRendererNode::AttributeStrategy::findUniformLocations(const Gloop::Program& program) {
-    // empty
-}
-
-GLsizei SlicingVolumeRendererNode::AttributeStrategy::getSizeOfQuad() {
-    return SIZE_OF_QUAD;
+SlicingVolumeRendererNode::AttributeStrategy::Packed*
+SlicingVolumeRendererNode::AttributeStrategy::loadVertex(Packed* data,
+                                                         const Vertex& vertex,
+                                                         const GLfloat z,
+                                                         const GLint unit,
+                                                         const GLfloat correction) {
+    data->position[0] = vertex.x; data->position[1] = vertex.y; data->position[2] = z;
+    data->coord[0] = toNormalized(vertex.s);
+    data->coord[1] = toNormalized(vertex.t);
+    data->coord[2] = toNormalized(vertex.p);
+    data->color[0] = Quantizer::toHalf((float) unit);
+    data->color[1] = Quantizer::toHalf(correction);
+    data->padding = 0;
+    return data + 1;
 }
 
 void SlicingVolumeRendererNode::AttributeStrategy::setUpAttributes(RapidGL::ProgramNode* programNode,
@@ -432,16 +1915,30 @@ void SlicingVolumeRendererNode::AttributeStrategy::setUpAttributes(RapidGL::Prog
     vao.vertexAttribPointer(Gloop::VertexAttribPointer()
             .index(coordLocation)
             .size(3)
-            .type(GL_FLOAT)
+            .type(GL_UNSIGNED_SHORT)
+            .normalized(true)
             .stride(SIZE_OF_VERTEX)
-            .offset(SIZE_OF_FLOAT * 3));
+            .offset(offsetof(Packed, coord)));
     vao.enableVertexAttribArray(colorLocation);
     vao.vertexAttribPointer(Gloop::VertexAttribPointer()
             .index(colorLocation)
-            .size(1)
-            .type(GL_FLOAT)
+            .size(2)
+            .type(GL_HALF_FLOAT)
             .stride(SIZE_OF_VERTEX)
-            .offset(SIZE_OF_FLOAT * 6));
+            .offset(offsetof(Packed, color)));
+}
+
+void SlicingVolumeRendererNode::AttributeStrategy::setUpVolumes(
+        const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode) {
+    // empty
+}
+
+bool SlicingVolumeRendererNode::AttributeStrategy::usesProxies() {
+    return false;
+}
+
+void SlicingVolumeRendererNode::AttributeStrategy::volumeChanged(const GLint unit) {
+    // empty
 }
 
 // ================
@@ -449,81 +1946,362 @@ void SlicingVolumeRendererNode::AttributeStrategy::setUpAttributes(RapidGL::Prog
 // ================
 
 SlicingVolumeRendererNode::UniformStrategy::UniformStrategy(const std::string& uniformName) :
-        uniformName(uniformName) {
+        uniformName(uniformName),
+        uniformLocation(-1),
+        correctionLocation(-1),
+        offsetLocation(-1) {
     if (uniformName.empty()) {
         throw std::invalid_argument("[SlicingVolumeRenderer] Uniform name is empty!");
     }
 }
 
-void SlicingVolumeRendererNode::UniformStrategy::draw(const std::vector<Quad>& quads) {
+void SlicingVolumeRendererNode::UniformStrategy::draw(const std::vector<Run>& runs,
+                                                      const std::vector<GLint>& firsts,
+                                                      const std::vector<GLsizei>& counts) {
+    const Run* last = NULL;
+    for (std::vector<Run>::const_iterator it = runs.begin(); it != runs.end(); ++it) {
 
-    const Gloop::BufferTarget arrayBuffer = Gloop::BufferTarget::arrayBuffer();
+        // Only change what differs from the last run
+        if ((last == NULL) || (it->unit != last->unit)) {
+            glUniform1i(uniformLocation, it->unit);
+        }
+        if ((last == NULL) || (it->correction != last->correction)) {
+            glUniform1f(correctionLocation, it->correction);
+        }
+        if ((last == NULL) || !std::equal(it->offset, it->offset + 3, last->offset)) {
+            glUniform3fv(offsetLocation, 1, it->offset);
+        }
+        last = &(*it);
+
+        // Draw every slice in the run at once
+        glMultiDrawArrays(GL_TRIANGLE_FAN, &firsts[it->first], &counts[it->first], it->count);
+    }
+}
 
-    const int floatsPerBuffer = FLOATS_PER_QUAD * quads.size();
-    GLfloat data[floatsPerBuffer];
+void SlicingVolumeRendererNode::UniformStrategy::draw(const std::vector<Proxy>& proxies) {
+    throw std::logic_error("[SlicingVolumeRendererNode] Uniform strategy does not draw proxies!");
+}
 
-    // Draw the quads
-    int count = 0;
-    GLint lastUnit = 0;
-    glUniform1i(uniformLocation, 0);
-    for (std::vector<Quad>::const_iterator it = quads.begin(); it != quads.end(); ++it) {
-
-        // Flush buffer if uniform changed
-        if (it->unit != lastUnit) {
-            arrayBuffer.subData(0, count * SIZE_OF_QUAD, data);
-            glDrawArrays(GL_TRIANGLES, 0, count * VERTICES_PER_QUAD);
-            glUniform1i(uniformLocation, it->unit);
-            lastUnit = it->unit;
-            count = 0;
+void SlicingVolumeRendererNode::UniformStrategy::findUniformLocations(const Gloop::Program& program) {
+    uniformLocation = program.uniformLocation(uniformName);
+    if (uniformLocation < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find uniform in program!");
+    }
+    correctionLocation = program.uniformLocation("OpacityCorrection");
+    offsetLocation = program.uniformLocation("SlabOffset");
+}
+
+GLsizei SlicingVolumeRendererNode::UniformStrategy::getSizeOfVertex() {
+    return SIZE_OF_VERTEX;
+}
+
+GLvoid* SlicingVolumeRendererNode::UniformStrategy::load(const Slice& slice, GLvoid* const ptr) {
+
+    Packed* data = (Packed*) ptr;
+
+    // Load the slice as a triangle fan
+    for (int i = 0; i < slice.count; ++i) {
+        data = loadVertex(data, slice.vertices[i], slice.z);
+    }
+    return data;
+}
+
+SlicingVolumeRendererNode::UniformStrategy::Packed*
+SlicingVolumeRendererNode::UniformStrategy::loadVertex(Packed* data, const Vertex& vertex, const GLfloat z) {
+    data->position[0] = vertex.x; data->position[1] = vertex.y; data->position[2] = z;
+    data->coord[0] = toNormalized(vertex.s);
+    data->coord[1] = toNormalized(vertex.t);
+    data->coord[2] = toNormalized(vertex.p);
+    data->padding = 0;
+    return data + 1;
+}
+
+void SlicingVolumeRendererNode::UniformStrategy::setUpAttributes(RapidGL::ProgramNode* programNode,
+                                                                 const Gloop::VertexArrayObject& vao) {
+
+    // Get program
+    const Gloop::Program program = programNode->getProgram();
+
+    // Find attribute names by usage
+    std::map<RapidGL::AttributeNode::Usage,std::string> attributeNamesByUsage;
+    const RapidGL::Node::node_range_t programNodeChildren = programNode->getChildren();
+    for (RapidGL::Node::node_iterator_t it = programNodeChildren.begin; it != programNodeChildren.end; ++it) {
+        const RapidGL::AttributeNode* attributeNode = dynamic_cast<RapidGL::AttributeNode*>(*it);
+        if (attributeNode != NULL) {
+            attributeNamesByUsage[attributeNode->getUsage()] = attributeNode->getName();
+        }
+    }
+
+    // Make sure a position and coordinate were specified
+    if (attributeNamesByUsage.count(RapidGL::AttributeNode::POSITION) == 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find attribute for position!");
+    }
+    if (attributeNamesByUsage.count(RapidGL::AttributeNode::TEXCOORD0) == 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find attribute for coordinate!");
+    }
+
+    // Find locations
+    const std::string positionName = attributeNamesByUsage[RapidGL::AttributeNode::POSITION];
+    const GLint pointLocation = program.attribLocation(positionName);
+    if (pointLocation < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find location for position attribute!");
+    }
+    const std::string coordName = attributeNamesByUsage[RapidGL::AttributeNode::TEXCOORD0];
+    const GLint coordLocation = program.attribLocation(coordName);
+    if (coordLocation < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find location for coordinate attribute!");
+    }
+
+    // Set up attributes
+    vao.enableVertexAttribArray(pointLocation);
+    vao.vertexAttribPointer(Gloop::VertexAttribPointer()
+            .index(pointLocation)
+            .size(3)
+            .type(GL_FLOAT)
+            .stride(SIZE_OF_VERTEX)
+            .offset(0));
+    vao.enableVertexAttribArray(coordLocation);
+    vao.vertexAttribPointer(Gloop::VertexAttribPointer()
+            .index(coordLocation)
+            .size(3)
+            .type(GL_UNSIGNED_SHORT)
+            .normalized(true)
+            .stride(SIZE_OF_VERTEX)
+            .offset(offsetof(Packed, coord)));
+}
+
+void SlicingVolumeRendererNode::UniformStrategy::setUpVolumes(
+        const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode) {
+    // empty
+}
+
+bool SlicingVolumeRendererNode::UniformStrategy::usesProxies() {
+    return false;
+}
+
+void SlicingVolumeRendererNode::UniformStrategy::volumeChanged(const GLint unit) {
+    // empty
+}
+
+// ==================
+// INSTANCED STRATEGY
+// ==================
+
+// Corners of the quad each slice is drawn with, as a triangle strip
+const GLfloat SlicingVolumeRendererNode::InstancedStrategy::QUAD[][FLOATS_PER_VERTEX] = {
+    { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }
+};
+
+/**
+ * Constructs an `InstancedStrategy`.
+ *
+ * Instead of making slices on the CPU, each volume is drawn as instances of one quad, and the vertex shader is
+ * expected to place each instance using the following uniforms:
+ *
+ * - `ExtentMin` and `ExtentMax`, the corners of the volume's bounding box in eye space
+ * - `NumberOfSlices`, the number of instances drawn
+ * - `OpacityCorrection`, if used, the exponent to correct opacity with for the number of slices
+ * - `EyeToVolume`, the matrix from eye space to the volume's texture coordinates
+ *
+ * The quad's corner comes in through the position attribute, from zero to one.  Instance `i` should be put at
+ * depth `mix(ExtentMin.z, ExtentMax.z, (i + 0.5) / NumberOfSlices)` and stretched over the extent in X and Y,
+ * and the fragment shader should discard texture coordinates outside of the unit cube.
+ *
+ * @param uniformName Name of sampler uniform to set to each volume's texture unit
+ * @throws std::invalid_argument if name of uniform is empty
+ */
+SlicingVolumeRendererNode::InstancedStrategy::InstancedStrategy(const std::string& uniformName) :
+        uniformName(uniformName),
+        uniformLocation(-1),
+        correctionLocation(-1),
+        extentMinLocation(-1),
+        extentMaxLocation(-1),
+        numberOfSlicesLocation(-1),
+        eyeToVolumeLocation(-1),
+        vbo(Gloop::BufferObject::generate()) {
+    if (uniformName.empty()) {
+        throw std::invalid_argument("[SlicingVolumeRenderer] Uniform name is empty!");
+    }
+}
+
+SlicingVolumeRendererNode::InstancedStrategy::~InstancedStrategy() {
+    vbo.dispose();
+}
+
+void SlicingVolumeRendererNode::InstancedStrategy::draw(const std::vector<Run>& runs,
+                                                        const std::vector<GLint>& firsts,
+                                                        const std::vector<GLsizei>& counts) {
+    throw std::logic_error("[SlicingVolumeRendererNode] Instanced strategy does not draw slices!");
+}
+
+void SlicingVolumeRendererNode::InstancedStrategy::draw(const std::vector<Proxy>& proxies) {
+    for (std::vector<Proxy>::const_iterator it = proxies.begin(); it != proxies.end(); ++it) {
+        GLfloat array[16];
+        SceneUtility::toArray(it->eyeToVolume, array);
+        glUniform1i(uniformLocation, it->unit);
+        glUniform1f(correctionLocation, it->correction);
+        glUniform1i(numberOfSlicesLocation, it->count);
+        glUniform3f(extentMinLocation, it->extent.min.x, it->extent.min.y, it->extent.min.z);
+        glUniform3f(extentMaxLocation, it->extent.max.x, it->extent.max.y, it->extent.max.z);
+        glUniformMatrix4fv(eyeToVolumeLocation, 1, GL_FALSE, array);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, it->count);
+    }
+}
+
+GLint SlicingVolumeRendererNode::InstancedStrategy::findUniformLocation(const Gloop::Program& program,
+                                                                        const std::string& name) {
+    const GLint location = program.uniformLocation(name);
+    if (location < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find uniform in program!");
+    }
+    return location;
+}
+
+void SlicingVolumeRendererNode::InstancedStrategy::findUniformLocations(const Gloop::Program& program) {
+    uniformLocation = findUniformLocation(program, uniformName);
+    extentMinLocation = findUniformLocation(program, "ExtentMin");
+    extentMaxLocation = findUniformLocation(program, "ExtentMax");
+    numberOfSlicesLocation = findUniformLocation(program, "NumberOfSlices");
+    eyeToVolumeLocation = findUniformLocation(program, "EyeToVolume");
+    correctionLocation = program.uniformLocation("OpacityCorrection");
+}
+
+GLsizei SlicingVolumeRendererNode::InstancedStrategy::getSizeOfVertex() {
+    return SIZE_OF_VERTEX;
+}
+
+GLvoid* SlicingVolumeRendererNode::InstancedStrategy::load(const Slice& slice, GLvoid* const ptr) {
+    throw std::logic_error("[SlicingVolumeRendererNode] Instanced strategy does not load slices!");
+}
+
+void SlicingVolumeRendererNode::InstancedStrategy::setUpAttributes(RapidGL::ProgramNode* programNode,
+                                                                   const Gloop::VertexArrayObject& vao) {
+
+    // Get program
+    const Gloop::Program program = programNode->getProgram();
+
+    // Find name of position attribute
+    std::string positionName;
+    const RapidGL::Node::node_range_t programNodeChildren = programNode->getChildren();
+    for (RapidGL::Node::node_iterator_t it = programNodeChildren.begin; it != programNodeChildren.end; ++it) {
+        const RapidGL::AttributeNode* attributeNode = dynamic_cast<RapidGL::AttributeNode*>(*it);
+        if ((attributeNode != NULL) && (attributeNode->getUsage() == RapidGL::AttributeNode::POSITION)) {
+            positionName = attributeNode->getName();
         }
+    }
+    if (positionName.empty()) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find attribute for position!");
+    }
 
-        int p = count * FLOATS_PER_QUAD;
+    // Find location
+    const GLint pointLocation = program.attribLocation(positionName);
+    if (pointLocation < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNode] Could not find location for position attribute!");
+    }
 
-        /* upper right */
-        data[p++] = it->v0.x; data[p++] = it->v0.y; data[p++] = it->z;
-        data[p++] = it->v0.s; data[p++] = it->v0.t; data[p++] = it->v0.p;
+    // Load the quad into its own buffer
+    const Gloop::BufferTarget arrayBuffer = Gloop::BufferTarget::arrayBuffer();
+    arrayBuffer.bind(vbo);
+    arrayBuffer.data(sizeof(QUAD), QUAD, GL_STATIC_DRAW);
 
-        /* upper left */
-        data[p++] = it->v1.x; data[p++] = it->v1.y; data[p++] = it->z;
-        data[p++] = it->v1.s; data[p++] = it->v1.t; data[p++] = it->v1.p;
+    // Set up attribute
+    vao.enableVertexAttribArray(pointLocation);
+    vao.vertexAttribPointer(Gloop::VertexAttribPointer()
+            .index(pointLocation)
+            .size(2)
+            .type(GL_FLOAT)
+            .stride(SIZE_OF_VERTEX)
+            .offset(0));
+}
 
-        /* lower left */
-        data[p++] = it->v2.x; data[p++] = it->v2.y; data[p++] = it->z;
-        data[p++] = it->v2.s; data[p++] = it->v2.t; data[p++] = it->v2.p;
+void SlicingVolumeRendererNode::InstancedStrategy::setUpVolumes(
+        const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode) {
+    // empty
+}
 
-        /* lower left */
-        data[p++] = it->v2.x; data[p++] = it->v2.y; data[p++] = it->z;
-        data[p++] = it->v2.s; data[p++] = it->v2.t; data[p++] = it->v2.p;
+bool SlicingVolumeRendererNode::InstancedStrategy::usesProxies() {
+    return true;
+}
 
-        /* lower right */
-        data[p++] = it->v3.x; data[p++] = it->v3.y; data[p++] = it->z;
-        data[p++] = it->v3.s; data[p++] = it->v3.t; data[p++] = it->v3.p;
+void SlicingVolumeRendererNode::InstancedStrategy::volumeChanged(const GLint unit) {
+    // empty
+}
 
-        /* upper right */
-        data[p++] = it->v0.x; data[p++] = it->v0.y; data[p++] = it->z;
-        data[p++] = it->v0.s; data[p++] = it->v0.t; data[p++] = it->v0.p;
+// ==============
+// ATLAS STRATEGY
+// ==============
 
-        ++count;
+SlicingVolumeRendererNode::AtlasStrategy::AtlasStrategy(const std::string& uniformName, const GLint unit) :
+        uniformName(uniformName),
+        uniformLocation(-1),
+        atlas(unit) {
+    if (uniformName.empty()) {
+        throw std::invalid_argument("[SlicingVolumeRenderer] Uniform name is empty!");
     }
-    if (count > 0) {
-        arrayBuffer.subData(0, count * SIZE_OF_QUAD, data);
-        glDrawArrays(GL_TRIANGLES, 0, count * VERTICES_PER_QUAD);
+}
+
+void SlicingVolumeRendererNode::AtlasStrategy::draw(const std::vector<Run>& runs,
+                                                    const std::vector<GLint>& firsts,
+                                                    const std::vector<GLsizei>& counts) {
+    glUniform1i(uniformLocation, atlas.getUnit());
+    atlas.bind();
+    if (!runs.empty()) {
+        const GLint first = runs.front().first;
+        const GLsizei count = runs.back().first + runs.back().count - first;
+        glMultiDrawArrays(GL_TRIANGLE_FAN, &firsts[first], &counts[first], count);
     }
 }
 
-void SlicingVolumeRendererNode::UniformStrategy::findUniformLocations(const Gloop::Program& program) {
+void SlicingVolumeRendererNode::AtlasStrategy::draw(const std::vector<Proxy>& proxies) {
+    throw std::logic_error("[SlicingVolumeRendererNode] Atlas strategy does not draw proxies!");
+}
+
+void SlicingVolumeRendererNode::AtlasStrategy::findUniformLocations(const Gloop::Program& program) {
     uniformLocation = program.uniformLocation(uniformName);
     if (uniformLocation < 0) {
         throw std::runtime_error("[SlicingVolumeRendererNode] Could not find uniform in program!");
     }
 }
 
-GLsizei SlicingVolumeRendererNode::UniformStrategy::getSizeOfQuad() {
-    return SIZE_OF_QUAD;
+GLsizei SlicingVolumeRendererNode::AtlasStrategy::getSizeOfVertex() {
+    return SIZE_OF_VERTEX;
 }
 
-void SlicingVolumeRendererNode::UniformStrategy::setUpAttributes(RapidGL::ProgramNode* programNode,
-                                                                 const Gloop::VertexArrayObject& vao) {
+GLvoid* SlicingVolumeRendererNode::AtlasStrategy::load(const Slice& slice, GLvoid* const ptr) {
+
+    Packed* data = (Packed*) ptr;
+
+    // Find where the volume is in the atlas
+    double scale[3];
+    double offset[3];
+    if (!atlas.findTransform(slice.unit, scale, offset)) {
+        throw std::logic_error("[SlicingVolumeRendererNode] Volume was not packed into atlas!");
+    }
+
+    // Load the slice as a triangle fan
+    for (int i = 0; i < slice.count; ++i) {
+        data = loadVertex(data, slice.vertices[i], slice.z, scale, offset, slice.correction);
+    }
+    return data;
+}
+
+SlicingVolumeRendererNode::AtlasStrategy::Packed*
+SlicingVolumeRendererNode::AtlasStrategy::loadVertex(Packed* data,
+                                                     const Vertex& vertex,
+                                                     const GLfloat z,
+                                                     const double scale[3],
+                                                     const double offset[3],
+                                                     const GLfloat correction) {
+    data->position[0] = vertex.x; data->position[1] = vertex.y; data->position[2] = z;
+    data->coord[0] = toNormalized((vertex.s * scale[0]) + offset[0]);
+    data->coord[1] = toNormalized((vertex.t * scale[1]) + offset[1]);
+    data->coord[2] = toNormalized((vertex.p * scale[2]) + offset[2]);
+    data->correction = Quantizer::toHalf(correction);
+    return data + 1;
+}
+
+void SlicingVolumeRendererNode::AtlasStrategy::setUpAttributes(RapidGL::ProgramNode* programNode,
+                                                               const Gloop::VertexArrayObject& vao) {
 
     // Get program
     const Gloop::Program program = programNode->getProgram();
@@ -570,7 +2348,46 @@ void SlicingVolumeRendererNode::UniformStrategy::setUpAttributes(RapidGL::Progra
     vao.vertexAttribPointer(Gloop::VertexAttribPointer()
             .index(coordLocation)
             .size(3)
-            .type(GL_FLOAT)
+            .type(GL_UNSIGNED_SHORT)
+            .normalized(true)
+            .stride(SIZE_OF_VERTEX)
+            .offset(offsetof(Packed, coord)));
+
+    // Opacity correction is optional
+    if (attributeNamesByUsage.count(RapidGL::AttributeNode::COLOR) == 0) {
+        return;
+    }
+    const std::string colorName = attributeNamesByUsage[RapidGL::AttributeNode::COLOR];
+    const GLint colorLocation = program.attribLocation(colorName);
+    if (colorLocation < 0) {
+        return;
+    }
+    vao.enableVertexAttribArray(colorLocation);
+    vao.vertexAttribPointer(Gloop::VertexAttribPointer()
+            .index(colorLocation)
+            .size(1)
+            .type(GL_HALF_FLOAT)
             .stride(SIZE_OF_VERTEX)
-            .offset(SIZE_OF_FLOAT * 3));
+            .offset(offsetof(Packed, correction)));
+}
+
+void SlicingVolumeRendererNode::AtlasStrategy::setUpVolumes(
+        const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode) {
+    typedef std::map<VolumeNode*,Gloop::TextureUnit>::const_iterator iterator_t;
+    std::vector<GLint> units;
+    for (iterator_t it = textureUnitsByVolumeNode.begin(); it != textureUnitsByVolumeNode.end(); ++it) {
+        if (it->first->getBrickCache() != NULL) {
+            throw std::runtime_error("[SlicingVolumeRendererNode] Atlas strategy can't slice bricked volumes!");
+        }
+        units.push_back(it->second.toOrdinal());
+    }
+    atlas.pack(units);
+}
+
+bool SlicingVolumeRendererNode::AtlasStrategy::usesProxies() {
+    return false;
+}
+
+void SlicingVolumeRendererNode::AtlasStrategy::volumeChanged(const GLint unit) {
+    atlas.refresh(unit);
 }
@@ -17,121 +17,422 @@
  */
 #ifndef GANDER_SLICING_VOLUME_RENDERER_NODE_H
 #define GANDER_SLICING_VOLUME_RENDERER_NODE_H
+#include <functional>
 #include <map>
 #include <queue>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <gloop/BufferObject.hxx>
-#include <gloop/BufferTarget.hxx>
 #include <gloop/Program.hxx>
 #include <gloop/TextureUnit.hxx>
 #include <gloop/VertexArrayObject.hxx>
 #include <m3d/Vec4.h>
 #include <m3d/Mat4.h>
+#include <Poco/Timestamp.h>
 #include <RapidGL/Node.h>
 #include <RapidGL/State.h>
 #include <RapidGL/ProgramNode.h>
+#include "Accumulator.h"
+#include "BlueNoise.h"
+#include "BrickCache.h"
+#include "Compositor.h"
+#include "DepthGrid.h"
+#include "SceneUtility.h"
+#include "SliceKernel.h"
+#include "StreamingBuffer.h"
+#include "VolumeAtlas.h"
 #include "VolumeNode.h"
+#include "WorkerPool.h"
 
 
 /**
  * Node rendering volumes using the slicing method.
+ *
+ * Each volume is normally cut into its own number of slices spread over its depth.  Given a spacing instead,
+ * every volume is cut by one shared set of planes that spacing apart in eye space, so slices of overlapping
+ * volumes line up and can be put in order plane by plane without sorting.
+ *
+ * Besides compositing, slices can be drawn as a maximum or minimum intensity projection, or simply added up.
+ * Those modes set their own blend equation and don't depend on order, so each volume's slices are drawn
+ * together without being merged by depth.  Slices can also be composited front to back into a `Compositor`,
+ * in which case the program must output colors premultiplied by alpha.  Every so many slices, pixels whose
+ * opacity passed a threshold are masked off with depth, so the slices behind them fail the depth test before
+ * they're shaded.
+ *
+ * Since drawing volumes is limited by fill, slices can also be drawn into the compositor at a half or a quarter
+ * of the size of the viewport, with a separate size while the view or volumes are moving.  The compositor
+ * scales the result back up without letting it bleed across the edges of the scene's geometry.
+ *
+ * Given a texture unit for jittering, the renderer binds a small tiling blue noise texture there and points a
+ * `JitterTexture` uniform at it.  A program can then push each pixel's sample back by a fraction of
+ * `SlabOffset`, which turns the banding left by few slices into fine grain.
+ *
+ * Given more than one pass, volumes sliced on the CPU keep being refined once nothing has moved for a moment.
+ * Each pass moves every slice a different fraction of the way through its slab, and the passes are averaged
+ * in an `Accumulator`, so a still image approaches one with several times as many slices while moving views
+ * stay cheap.  Passes only hold the volumes, and the average is laid over the scene every frame, so the rest
+ * of the scene stays live.  Once every pass is in, the average is simply laid over the scene again until the
+ * view, a volume, or a transform or framebuffer node elsewhere in the scene changes.
+ *
+ * Given the identifier of a texture node holding the depth of the opaque scene, drawn by an earlier
+ * framebuffer pass, each re-slice reads the depth back into a `DepthGrid`.  Slices entirely behind the scene
+ * are dropped, and the rest are trimmed to the tiles where the scene is farther away.  The depth test is then
+ * left on without depth writes while drawing, so fragments behind geometry in the framebuffer are rejected
+ * before they're shaded.  Since the scene may have moved while the view and volumes stayed put, every volume
+ * is re-sliced whenever the depth texture node, or any transform or framebuffer node outside the renderer,
+ * reports a change.
+ *
+ * Slices made on the CPU are drawn as triangle fans.  Vertices hold a float position and texture coordinates
+ * as normalized unsigned shorts.  The atlas strategy adds the opacity correction as a half float color
+ * attribute, and the attribute strategy adds the texture unit and opacity correction, in that order, as a two
+ * component half float color attribute.
+ *
+ * With the uniform strategy, the program may also take a `SlabOffset` uniform, the step in texture
+ * coordinates from a slice to the one behind it, so a pre-integrated table can be looked up with the values
+ * at both ends of each slab.
+ *
+ * The atlas strategy copies every volume into one `VolumeAtlas`, so slices of any number of volumes are drawn
+ * with a single call no matter how they interleave, and the program only needs one sampler however many
+ * volumes there are.  Its vertices carry the opacity correction as a color attribute instead of a uniform.
+ * The copies are read back from each volume's own texture, though, so every volume still needs its own
+ * texture unit and keeps its own texture, which means volumes take twice the memory on the GPU.  The volumes
+ * are also stacked along Z, so together they can't be deeper than the largest 3D texture.
  */
-class SlicingVolumeRendererNode : public RapidGL::Node {
+class SlicingVolumeRendererNode : public RapidGL::Node, public RapidGL::NodeListener {
 private:
 // Constants
-    static const int VERTICES_PER_QUAD = 6;
+    static const int MAX_VERTICES_PER_SLICE = 12;
     static const GLsizei SIZE_OF_FLOAT = sizeof(GLfloat);
+    static const M3d::Vec4 CORNERS[8];
+    static const int EDGES[12][2];
+    static const int MIN_SLICES = 16;
+    static const int REFINE_DELAY = 250000;
+    static const int JITTER_SIZE = 64;
 // Types
     struct Extent {
         M3d::Vec4 min;
         M3d::Vec4 max;
     };
     struct Vertex {
-        double x, y;
-        double s, t, p;
+        GLfloat x, y;
+        GLfloat s, t, p;
     };
-    struct Quad {
-    // Attributes
+    struct Slice {
+        GLint unit;
+        GLfloat correction;
+        GLfloat offset[3];
+        GLfloat z;
+        int plane;
+        int count;
+        Vertex vertices[MAX_VERTICES_PER_SLICE];
+    };
+    struct Run {
         GLint unit;
+        GLfloat correction;
+        GLfloat offset[3];
+        GLint first;
+        GLsizei count;
+    };
+    struct Proxy {
+        GLint unit;
+        GLfloat correction;
+        int count;
+        M3d::Mat4 eyeToVolume;
+        Extent extent;
+    };
+    struct Placement {
+        const Slice* slice;
+        GLint position;
+    };
+    struct Task {
+        VolumeNode* volumeNode;
+        GLint unit;
+        GLfloat correction;
+        int count;
         double z;
-        Vertex v0;
-        Vertex v1;
-        Vertex v2;
-        Vertex v3;
+        double dz;
+        int plane;
+        M3d::Mat4 modelViewMatrix;
+        const OccupancyGrid* occupancyGrid;
+        BrickCache* brickCache;
+        std::vector<int> visible;
+        int begin;
+        int end;
+        std::vector<Slice> slices;
+        std::vector<int> bricks;
+    };
+    struct Depth {
+        GLboolean testing;
+        GLboolean writing;
+    };
+    struct Blending {
+        bool saved;
+        GLboolean enabled;
+        GLint equationRgb;
+        GLint equationAlpha;
+        GLint sourceRgb;
+        GLint destinationRgb;
+        GLint sourceAlpha;
+        GLint destinationAlpha;
+    };
+    struct Cursor {
+    // Attributes
+        const Slice* slice;
+        const Slice* end;
     // Methods
-        Vertex& operator[](int i) {
-            switch (i) {
-            case 0: return v0;
-            case 1: return v1;
-            case 2: return v2;
-            case 3: return v3;
-            default:
-                throw std::out_of_range("Index is out of bounds!");
-            }
-        }
+        Cursor(const std::vector<Slice>& slices);
+        bool operator>(const Cursor& that) const;
     };
 public:
 // Types
+    enum Mode {
+        COMPOSITE,
+        MAXIMUM,
+        MINIMUM,
+        ADDITIVE,
+        FRONT_TO_BACK
+    };
     class Strategy {
     public:
-        virtual void draw(const std::vector<Quad>& quads) = 0;
+        virtual void draw(const std::vector<Run>& runs,
+                          const std::vector<GLint>& firsts,
+                          const std::vector<GLsizei>& counts) = 0;
+        virtual void draw(const std::vector<Proxy>& proxies) = 0;
         virtual void findUniformLocations(const Gloop::Program&) = 0;
-        virtual GLsizei getSizeOfQuad() = 0;
+        virtual GLsizei getSizeOfVertex() = 0;
+        virtual GLvoid* load(const Slice& slice, GLvoid* data) = 0;
         virtual void setUpAttributes(RapidGL::ProgramNode*, const Gloop::VertexArrayObject&) = 0;
+        virtual void setUpVolumes(const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode) = 0;
+        virtual bool usesProxies() = 0;
+        virtual void volumeChanged(GLint unit) = 0;
     };
     class AttributeStrategy : public Strategy {
     public:
         AttributeStrategy();
-        virtual void draw(const std::vector<Quad>& quads);
+        virtual void draw(const std::vector<Run>& runs,
+                          const std::vector<GLint>& firsts,
+                          const std::vector<GLsizei>& counts);
+        virtual void draw(const std::vector<Proxy>& proxies);
         virtual void findUniformLocations(const Gloop::Program&);
-        virtual GLsizei getSizeOfQuad();
+        virtual GLsizei getSizeOfVertex();
+        virtual GLvoid* load(const Slice& slice, GLvoid* data);
         virtual void setUpAttributes(RapidGL::ProgramNode*, const Gloop::VertexArrayObject&);
+        virtual void setUpVolumes(const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode);
+        virtual bool usesProxies();
+        virtual void volumeChanged(GLint unit);
     private:
-        static const int FLOATS_PER_VERTEX = 7;
-        static const int FLOATS_PER_QUAD = VERTICES_PER_QUAD * FLOATS_PER_VERTEX;
-        static const GLsizei SIZE_OF_VERTEX = SIZE_OF_FLOAT * FLOATS_PER_VERTEX;
-        static const GLsizei SIZE_OF_QUAD = SIZE_OF_VERTEX * VERTICES_PER_QUAD;
+        struct Packed {
+            GLfloat position[3];
+            GLushort coord[3];
+            GLushort color[2];
+            GLushort padding;
+        };
+        static const GLsizei SIZE_OF_VERTEX = sizeof(Packed);
+        static Packed* loadVertex(Packed* data, const Vertex& vertex, GLfloat z, GLint unit, GLfloat correction);
     };
     class UniformStrategy : public Strategy {
     public:
         UniformStrategy(const std::string& uniformName);
-        virtual void draw(const std::vector<Quad>& quads);
+        virtual void draw(const std::vector<Run>& runs,
+                          const std::vector<GLint>& firsts,
+                          const std::vector<GLsizei>& counts);
+        virtual void draw(const std::vector<Proxy>& proxies);
+        virtual void findUniformLocations(const Gloop::Program& program);
+        virtual GLsizei getSizeOfVertex();
+        virtual GLvoid* load(const Slice& slice, GLvoid* data);
+        virtual void setUpAttributes(RapidGL::ProgramNode*, const Gloop::VertexArrayObject&);
+        virtual void setUpVolumes(const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode);
+        virtual bool usesProxies();
+        virtual void volumeChanged(GLint unit);
+    private:
+        struct Packed {
+            GLfloat position[3];
+            GLushort coord[3];
+            GLushort padding;
+        };
+        static const GLsizei SIZE_OF_VERTEX = sizeof(Packed);
+        const std::string uniformName;
+        GLint uniformLocation;
+        GLint correctionLocation;
+        GLint offsetLocation;
+        static Packed* loadVertex(Packed* data, const Vertex& vertex, GLfloat z);
+    };
+    class InstancedStrategy : public Strategy {
+    public:
+        InstancedStrategy(const std::string& uniformName);
+        virtual ~InstancedStrategy();
+        virtual void draw(const std::vector<Run>& runs,
+                          const std::vector<GLint>& firsts,
+                          const std::vector<GLsizei>& counts);
+        virtual void draw(const std::vector<Proxy>& proxies);
         virtual void findUniformLocations(const Gloop::Program& program);
-        virtual GLsizei getSizeOfQuad();
+        virtual GLsizei getSizeOfVertex();
+        virtual GLvoid* load(const Slice& slice, GLvoid* data);
         virtual void setUpAttributes(RapidGL::ProgramNode*, const Gloop::VertexArrayObject&);
+        virtual void setUpVolumes(const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode);
+        virtual bool usesProxies();
+        virtual void volumeChanged(GLint unit);
     private:
-        static const int FLOATS_PER_VERTEX = 6;
-        static const int FLOATS_PER_QUAD = VERTICES_PER_QUAD * FLOATS_PER_VERTEX;
+        static const int FLOATS_PER_VERTEX = 2;
         static const GLsizei SIZE_OF_VERTEX = SIZE_OF_FLOAT * FLOATS_PER_VERTEX;
-        static const GLsizei SIZE_OF_QUAD = SIZE_OF_VERTEX * VERTICES_PER_QUAD;
+        static const GLfloat QUAD[4][FLOATS_PER_VERTEX];
         const std::string uniformName;
         GLint uniformLocation;
+        GLint correctionLocation;
+        GLint extentMinLocation;
+        GLint extentMaxLocation;
+        GLint numberOfSlicesLocation;
+        GLint eyeToVolumeLocation;
+        const Gloop::BufferObject vbo;
+        static GLint findUniformLocation(const Gloop::Program& program, const std::string& name);
+    };
+    class AtlasStrategy : public Strategy {
+    public:
+        AtlasStrategy(const std::string& uniformName, GLint unit);
+        virtual void draw(const std::vector<Run>& runs,
+                          const std::vector<GLint>& firsts,
+                          const std::vector<GLsizei>& counts);
+        virtual void draw(const std::vector<Proxy>& proxies);
+        virtual void findUniformLocations(const Gloop::Program& program);
+        virtual GLsizei getSizeOfVertex();
+        virtual GLvoid* load(const Slice& slice, GLvoid* data);
+        virtual void setUpAttributes(RapidGL::ProgramNode*, const Gloop::VertexArrayObject&);
+        virtual void setUpVolumes(const std::map<VolumeNode*,Gloop::TextureUnit>& textureUnitsByVolumeNode);
+        virtual bool usesProxies();
+        virtual void volumeChanged(GLint unit);
+    private:
+        struct Packed {
+            GLfloat position[3];
+            GLushort coord[3];
+            GLushort correction;
+        };
+        static const GLsizei SIZE_OF_VERTEX = sizeof(Packed);
+        const std::string uniformName;
+        GLint uniformLocation;
+        VolumeAtlas atlas;
+        static Packed* loadVertex(Packed* data,
+                                  const Vertex& vertex,
+                                  GLfloat z,
+                                  const double scale[3],
+                                  const double offset[3],
+                                  GLfloat correction);
     };
 // Methods
-    SlicingVolumeRendererNode(Strategy* strategy, const int numberOfSlices);
+    SlicingVolumeRendererNode(Strategy* strategy,
+                              int numberOfSlices,
+                              int interactiveSlices,
+                              double spacing,
+                              Mode mode,
+                              GLint jitterUnit,
+                              int passes,
+                              const std::string& depthId,
+                              GLfloat threshold,
+                              int interval,
+                              int downsample,
+                              int interactiveDownsample);
     virtual ~SlicingVolumeRendererNode();
+    bool isEnabled() const;
+    virtual void nodeChanged(RapidGL::Node* node);
     virtual void preVisit(RapidGL::State& state);
+    void setEnabled(bool enabled);
     virtual void visit(RapidGL::State& state);
 private:
 // Attributes
     bool ready;
-    const Gloop::BufferTarget arrayBuffer;
+    bool enabled;
     const Gloop::VertexArrayObject vao;
-    const Gloop::BufferObject vbo;
+    StreamingBuffer streamingBuffer;
     const int numberOfSlices;
+    const int interactiveSlices;
+    const double spacing;
+    const Mode mode;
+    const GLint jitterUnit;
+    GLuint jitterTexture;
+    GLint jitterLocation;
+    const int passes;
+    int pass;
+    Accumulator accumulator;
+    const std::string depthId;
+    GLint depthUnit;
+    DepthGrid depthGrid;
+    std::vector<float> depths;
+    const GLfloat threshold;
+    const int interval;
+    Compositor compositor;
+    const int downsample;
+    const int interactiveDownsample;
     Strategy* const strategy;
     std::vector<VolumeNode*> volumeNodes;
     std::map<VolumeNode*,Gloop::TextureUnit> textureUnitsByVolumeNode;
+    std::multimap<RapidGL::Node*,VolumeNode*> volumeNodesByTransformNode;
+    std::set<RapidGL::Node*> sceneNodes;
+    std::map<VolumeNode*,std::vector<Slice> > slicesByVolumeNode;
+    std::set<VolumeNode*> dirtyVolumeNodes;
+    std::set<VolumeNode*> changedVolumeNodes;
+    M3d::Mat4 viewMatrix;
+    M3d::Mat4 projectionMatrix;
+    std::vector<Run> runs;
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+    WorkerPool& workerPool;
+    M3d::Vec4 frustum[6];
+    std::vector<Task> tasks;
+    std::vector<Placement> placements;
+    GLvoid* data;
+    std::vector<Proxy> proxies;
+    bool moved;
+    bool interacting;
+    Poco::Timestamp lastMove;
+    GLint viewport[4];
 // Methods
-    static Extent findExtent(const VolumeNode* volumeNode, const M3d::Mat4& viewMatrix);
+    static int assemble(const SliceKernel::Batch& batch, int k, Vertex* out);
+    Depth beginDepth() const;
+    Blending beginMode(bool offscreen) const;
+    static int clip(const Vertex* in, int count, const double distances[], Vertex* out);
+    static void clip(Slice& slice, const M3d::Vec4 planes[6]);
+    static bool clip(Slice& slice, const OccupancyGrid& occupancyGrid);
+    static bool clip(Slice& slice, const DepthGrid& depthGrid, const M3d::Mat4& projectionMatrix);
+    static bool clip(const Slice& slice, int axis, double min, double max, Slice& piece);
+    int countSlices(const M3d::Vec4 points[8]) const;
+    static int countVertices(const Slice& slice);
+    void draw(bool accumulating);
+    void drawFrontToBack();
+    void endDepth(const Depth& depth) const;
+    void endMode(const Blending& blending) const;
+    static bool equals(const M3d::Mat4& m1, const M3d::Mat4& m2);
+    static void findBox(const Slice& slice, double min[3], double max[3]);
+    static void findEdges(const M3d::Vec4 points[8], double z, double dz, SliceKernel::Edge edges[12]);
+    static Extent findExtent(const M3d::Vec4 points[8]);
+    static void findFrustum(const M3d::Mat4& projectionMatrix, M3d::Vec4 planes[6]);
+    void findOverlay(GLenum& equation, GLenum& source, GLenum& destination) const;
     template<typename T> static T* findDescendant(RapidGL::Node* node);
-    template<typename T> static std::vector<T*> findDescendants(RapidGL::Node* node);
-    static M3d::Mat4 getModelMatrix(const RapidGL::Node* node);
     Gloop::TextureUnit getTextureUnit(VolumeNode* volumeNode) const;
+    static double getPseudoAngle(double x, double y);
+    static double getShift(int pass);
+    static bool isFarther(const Proxy& p1, const Proxy& p2);
+    bool isOrdered() const;
+    void loadSlices(int worker, int numberOfWorkers);
+    void makeJitterTexture();
+    void makeProxies();
+    void makeTasks();
+    GLsizei merge();
+    void observeScene(RapidGL::TextureNode* textureNode);
+    void place(const Slice& slice, GLint& position);
     void putTextureUnit(VolumeNode* volumeNode, const Gloop::TextureUnit& textureUnit);
-    static bool compare(const Quad& q1, const Quad& q2);
+    void readDepth();
+    void requestBricks();
+    void reverse();
+    void sliceTasks(int worker, int numberOfWorkers);
+    void sliceVolume(Task& task) const;
+    static void split(const Slice& slice,
+                      const BrickCache& brickCache,
+                      const std::vector<int>& visible,
+                      std::vector<Slice>& pieces,
+                      std::vector<int>& bricks);
+    static GLushort toNormalized(double coordinate);
+    void update();
 };
 
 
@@ -165,36 +466,4 @@ T* SlicingVolumeRendererNode::findDescendant(RapidGL::Node* rootNode) {
     return NULL;
 }
 
-/**
- * Finds all the descendants of a node of a particular type.
- *
- * @param rootNode Node to search from
- * @return Vector of the descendants of the specified type
- * @throw std::invalid_argument if root node is `NULL`
- */
-template<typename T>
-std::vector<T*> SlicingVolumeRendererNode::findDescendants(RapidGL::Node* const rootNode) {
-
-    if (rootNode == NULL) {
-        throw std::invalid_argument("Root node is NULL!");
-    }
-
-    std::vector<T*> ts;
-
-    std::queue<RapidGL::Node*> q;
-    q.push(rootNode);
-
-    while (!q.empty()) {
-        RapidGL::Node* const node = q.front();
-        T* const t = dynamic_cast<T*>(node);
-        if (t != NULL) {
-            ts.push_back(t);
-        }
-        RapidGL::addToQueue(q, node->getChildren());
-        q.pop();
-    }
-
-    return ts;
-}
-
 #endif
@@ -19,6 +19,9 @@
 #include <Poco/String.h>
 #include "SlicingVolumeRendererNodeUnmarshaller.h"
 
+// Opacity pixels stop taking slices at when compositing front to back, if not specified
+const GLfloat SlicingVolumeRendererNodeUnmarshaller::DEFAULT_THRESHOLD = 0.95f;
+
 /**
  * Constructs a `SlicingVolumeRendererNodeUnmarshaller`.
  */
@@ -33,6 +36,168 @@ SlicingVolumeRendererNodeUnmarshaller::~SlicingVolumeRendererNodeUnmarshaller()
     // empty
 }
 
+/**
+ * Determines the value of the _depth_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Identifier of texture node holding depth of the scene, or an empty string if not specified
+ */
+std::string SlicingVolumeRendererNodeUnmarshaller::getDepth(const std::map<std::string,std::string>& map) {
+    return findValue(map, "depth");
+}
+
+/**
+ * Determines the value of the _downsample_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Number to divide the size of the viewport by when drawing volumes, or one if not specified
+ * @throws std::runtime_error if downsample is not 1, 2, or 4
+ */
+int SlicingVolumeRendererNodeUnmarshaller::getDownsample(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "downsample");
+    if (value.empty()) {
+        return 1;
+    }
+    const int downsample = parseInt(value);
+    if ((downsample != 1) && (downsample != 2) && (downsample != 4)) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Downsample must be 1, 2, or 4!");
+    }
+    return downsample;
+}
+
+/**
+ * Determines the value of the _interactiveDownsample_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @param downsample Value of the _downsample_ attribute
+ * @return Number to divide the size of the viewport by while things move, or downsample if not specified
+ * @throws std::runtime_error if interactive downsample is not 1, 2, or 4
+ */
+int SlicingVolumeRendererNodeUnmarshaller::getInteractiveDownsample(const std::map<std::string,std::string>& map,
+                                                                    const int downsample) {
+    const std::string value = findValue(map, "interactiveDownsample");
+    if (value.empty()) {
+        return downsample;
+    }
+    const int interactiveDownsample = parseInt(value);
+    if ((interactiveDownsample != 1) && (interactiveDownsample != 2) && (interactiveDownsample != 4)) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Bad interactive downsample!");
+    }
+    return interactiveDownsample;
+}
+
+/**
+ * Determines the value of the _interactiveSlices_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @param slices Value of the _slices_ attribute
+ * @return Value of the attribute in the map, or a fraction of the slices if not specified
+ */
+GLint SlicingVolumeRendererNodeUnmarshaller::getInteractiveSlices(const std::map<std::string,std::string>& map,
+                                                                  const GLint slices) {
+
+    // Get value
+    const std::string value = findValue(map, "interactiveSlices");
+
+    // If nothing specified, just return the default
+    if (value.empty()) {
+        return slices / DEFAULT_INTERACTIVE_DIVISOR;
+    }
+
+    // Parse value
+    const GLint interactiveSlices = parseInt(value);
+    if (interactiveSlices < 0) {
+        throw std::runtime_error("Interactive slices cannot be negative!");
+    } else if (interactiveSlices > slices) {
+        throw std::runtime_error("Interactive slices cannot be more than slices!");
+    }
+
+    // Return it
+    return interactiveSlices;
+}
+
+/**
+ * Determines the value of the _interval_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Number of slices between masking off opaque pixels, or the default if not specified
+ * @throws std::runtime_error if interval is not positive
+ */
+int SlicingVolumeRendererNodeUnmarshaller::getInterval(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "interval");
+    if (value.empty()) {
+        return DEFAULT_INTERVAL;
+    }
+    const int interval = parseInt(value);
+    if (interval <= 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Interval must be positive!");
+    }
+    return interval;
+}
+
+/**
+ * Determines the value of the _jitter_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Texture unit to bind noise for jittering to, or -1 to not jitter if not specified
+ * @throws std::runtime_error if unit is negative
+ */
+GLint SlicingVolumeRendererNodeUnmarshaller::getJitter(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "jitter");
+    if (value.empty()) {
+        return -1;
+    }
+    const GLint unit = parseInt(value);
+    if (unit < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Jitter unit must not be negative!");
+    }
+    return unit;
+}
+
+/**
+ * Determines the value of the _mode_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Value of the attribute in the map, or compositing if not specified
+ * @throws std::runtime_error if mode is not `composite`, `maximum`, `minimum`, `additive`, or `frontToBack`
+ */
+SlicingVolumeRendererNode::Mode
+SlicingVolumeRendererNodeUnmarshaller::getMode(const std::map<std::string,std::string>& map) {
+    const std::string value = Poco::toLower(findValue(map, "mode"));
+    if (value.empty() || (value == "composite")) {
+        return SlicingVolumeRendererNode::COMPOSITE;
+    } else if (value == "maximum") {
+        return SlicingVolumeRendererNode::MAXIMUM;
+    } else if (value == "minimum") {
+        return SlicingVolumeRendererNode::MINIMUM;
+    } else if (value == "additive") {
+        return SlicingVolumeRendererNode::ADDITIVE;
+    } else if (value == "fronttoback") {
+        return SlicingVolumeRendererNode::FRONT_TO_BACK;
+    } else {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Unrecognized mode!");
+    }
+}
+
+/**
+ * Determines the value of the _passes_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Number of passes to average while nothing moves, or one to not refine if not specified
+ * @throws std::runtime_error if passes is less than one
+ */
+int SlicingVolumeRendererNodeUnmarshaller::getPasses(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "passes");
+    if (value.empty()) {
+        return 1;
+    }
+    const int passes = parseInt(value);
+    if (passes < 1) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Passes must be at least one!");
+    }
+    return passes;
+}
+
 /**
  * Determines the value of the _slices_ attribute in a map.
  *
@@ -59,6 +224,33 @@ GLint SlicingVolumeRendererNodeUnmarshaller::getSlices(const std::map<std::strin
     return slices;
 }
 
+/**
+ * Determines the value of the _spacing_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Value of the attribute in the map, or zero to slice each volume on its own if not specified
+ * @throws std::runtime_error if spacing is negative
+ */
+double SlicingVolumeRendererNodeUnmarshaller::getSpacing(const std::map<std::string,std::string>& map) {
+
+    // Get value
+    const std::string value = findValue(map, "spacing");
+
+    // If nothing specified, don't share planes
+    if (value.empty()) {
+        return 0;
+    }
+
+    // Parse value
+    const double spacing = parseFloat(value);
+    if (spacing < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Spacing cannot be negative!");
+    }
+
+    // Return it
+    return spacing;
+}
+
 /**
  * Determines the value of the _strategy_ attribute in a map.
  *
@@ -68,11 +260,31 @@ GLint SlicingVolumeRendererNodeUnmarshaller::getSlices(const std::map<std::strin
 std::string SlicingVolumeRendererNodeUnmarshaller::getStrategy(const std::map<std::string,std::string>& map) {
     const std::string value = findValue(map, "strategy");
     const std::string valueAsLower = Poco::toLower(value);
-    if (valueAsLower != "attribute" && valueAsLower != "uniform") {
+    if (valueAsLower != "attribute" && valueAsLower != "uniform" && valueAsLower != "instanced"
+            && valueAsLower != "atlas") {
     }
     return valueAsLower;
 }
 
+/**
+ * Determines the value of the _threshold_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Opacity at which pixels are masked off, or the default if not specified
+ * @throws std::runtime_error if threshold is not in (0, 1]
+ */
+GLfloat SlicingVolumeRendererNodeUnmarshaller::getThreshold(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "threshold");
+    if (value.empty()) {
+        return DEFAULT_THRESHOLD;
+    }
+    const GLfloat threshold = parseFloat(value);
+    if ((threshold <= 0) || (threshold > 1)) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Threshold must be in (0, 1]!");
+    }
+    return threshold;
+}
+
 /**
  * Determines the value of the _uniform_ attribute in a map.
  *
@@ -84,6 +296,25 @@ std::string SlicingVolumeRendererNodeUnmarshaller::getUniform(const std::map<std
     return value;
 }
 
+/**
+ * Determines the value of the _unit_ attribute in a map.
+ *
+ * @param map Map of XML attributes
+ * @return Value of the attribute in the map
+ * @throws std::runtime_error if unit is unspecified or negative
+ */
+GLint SlicingVolumeRendererNodeUnmarshaller::getUnit(const std::map<std::string,std::string>& map) {
+    const std::string value = findValue(map, "unit");
+    if (value.empty()) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Unit is unspecified!");
+    }
+    const GLint unit = parseInt(value);
+    if (unit < 0) {
+        throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Unit must not be negative!");
+    }
+    return unit;
+}
+
 /**
  * Creates a `SlicingVolumeRendererNode` from a map of XML attributes.
  *
@@ -97,6 +328,16 @@ RapidGL::Node* SlicingVolumeRendererNodeUnmarshaller::unmarshal(const std::map<s
 
     // Get number of slices
     const GLint slices = getSlices(attributes);
+    const GLint interactiveSlices = getInteractiveSlices(attributes, slices);
+    const double spacing = getSpacing(attributes);
+    const SlicingVolumeRendererNode::Mode mode = getMode(attributes);
+    const GLint jitter = getJitter(attributes);
+    const int passes = getPasses(attributes);
+    const std::string depth = getDepth(attributes);
+    const GLfloat threshold = getThreshold(attributes);
+    const GLint interval = getInterval(attributes);
+    const int downsample = getDownsample(attributes);
+    const int interactiveDownsample = getInteractiveDownsample(attributes, downsample);
 
     // Get strategy
     const std::string strategyAsString = getStrategy(attributes);
@@ -108,10 +349,31 @@ RapidGL::Node* SlicingVolumeRendererNodeUnmarshaller::unmarshal(const std::map<s
             throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Value of uniform is unspecified!");
         }
         strategy = new SlicingVolumeRendererNode::UniformStrategy(uniform);
+    } else if (strategyAsString == "instanced") {
+        if (uniform.empty()) {
+            throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Value of uniform is unspecified!");
+        }
+        strategy = new SlicingVolumeRendererNode::InstancedStrategy(uniform);
+    } else if (strategyAsString == "atlas") {
+        if (uniform.empty()) {
+            throw std::runtime_error("[SlicingVolumeRendererNodeUnmarshaller] Value of uniform is unspecified!");
+        }
+        strategy = new SlicingVolumeRendererNode::AtlasStrategy(uniform, getUnit(attributes));
     } else {
         throw std::runtime_error("Unrecognized strategy!");
     }
 
     // Create node
-    return new SlicingVolumeRendererNode(strategy, slices);
+    return new SlicingVolumeRendererNode(strategy,
+                                         slices,
+                                         interactiveSlices,
+                                         spacing,
+                                         mode,
+                                         jitter,
+                                         passes,
+                                         depth,
+                                         threshold,
+                                         interval,
+                                         downsample,
+                                         interactiveDownsample);
 }
@@ -36,10 +36,24 @@ public:
 private:
 // Constants
     static const GLint DEFAULT_SLICES = 100;
+    static const GLint DEFAULT_INTERACTIVE_DIVISOR = 4;
+    static const int DEFAULT_INTERVAL = 16;
+    static const GLfloat DEFAULT_THRESHOLD;
 // Methods
+    static std::string getDepth(const std::map<std::string,std::string>& attributes);
+    static int getDownsample(const std::map<std::string,std::string>& attributes);
+    static int getInteractiveDownsample(const std::map<std::string,std::string>& attributes, int downsample);
+    static GLint getInteractiveSlices(const std::map<std::string,std::string>& attributes, GLint slices);
+    static int getInterval(const std::map<std::string,std::string>& attributes);
+    static GLint getJitter(const std::map<std::string,std::string>& attributes);
+    static SlicingVolumeRendererNode::Mode getMode(const std::map<std::string,std::string>& attributes);
+    static int getPasses(const std::map<std::string,std::string>& attributes);
     static GLint getSlices(const std::map<std::string,std::string>& attributes);
+    static double getSpacing(const std::map<std::string,std::string>& attributes);
     static std::string getStrategy(const std::map<std::string,std::string>& attributes);
+    static GLfloat getThreshold(const std::map<std::string,std::string>& attributes);
     static std::string getUniform(const std::map<std::string,std::string>& attributes);
+    static GLint getUnit(const std::map<std::string,std::string>& attributes);
 };
 
 #endif
@@ -0,0 +1,166 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "StreamingBuffer.h"
+
+/**
+ * Constructs a `StreamingBuffer`.
+ */
+StreamingBuffer::StreamingBuffer() :
+        arrayBuffer(Gloop::BufferTarget::arrayBuffer()),
+        vbo(Gloop::BufferObject::generate()),
+        sizeOfRegion(0),
+        region(NUMBER_OF_REGIONS - 1) {
+    for (int i = 0; i < NUMBER_OF_REGIONS; ++i) {
+        fences[i] = NULL;
+    }
+}
+
+/**
+ * Destructs a `StreamingBuffer`.
+ */
+StreamingBuffer::~StreamingBuffer() {
+    for (int i = 0; i < NUMBER_OF_REGIONS; ++i) {
+        if (fences[i] != NULL) {
+            glDeleteSync(fences[i]);
+        }
+    }
+    vbo.dispose();
+}
+
+/**
+ * Allocates storage for the buffer.
+ *
+ * Buffer must be bound.
+ *
+ * @param sizeOfRegion Size in bytes of the largest amount of data written between fences
+ * @throws std::invalid_argument if size of region is not positive
+ */
+void StreamingBuffer::allocate(const GLsizeiptr sizeOfRegion) {
+
+    if (sizeOfRegion <= 0) {
+        throw std::invalid_argument("[StreamingBuffer] Size of region is not positive!");
+    }
+
+    this->sizeOfRegion = sizeOfRegion;
+    arrayBuffer.data(sizeOfRegion * NUMBER_OF_REGIONS, NULL, GL_STREAM_DRAW);
+}
+
+/**
+ * Binds the buffer to the array buffer target.
+ */
+void StreamingBuffer::bind() const {
+    arrayBuffer.bind(vbo);
+}
+
+/**
+ * Marks the current region as in use by all commands issued so far.
+ */
+void StreamingBuffer::fence() {
+    if (fences[region] != NULL) {
+        glDeleteSync(fences[region]);
+    }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/**
+ * Returns the number of bytes in each region of the buffer.
+ */
+GLsizeiptr StreamingBuffer::getSizeOfRegion() const {
+    return sizeOfRegion;
+}
+
+/**
+ * Maps the next region of the buffer for writing.
+ *
+ * Buffer must be bound.  Waits until the GPU is done with the region if it was fenced.
+ *
+ * @param size Size in bytes to map, which must not be greater than the size of a region
+ * @return Pointer to the mapped memory
+ * @throws std::invalid_argument if size is not positive or greater than the size of a region
+ * @throws std::runtime_error if region could not be mapped
+ */
+GLvoid* StreamingBuffer::map(const GLsizeiptr size) {
+
+    if (size <= 0) {
+        throw std::invalid_argument("[StreamingBuffer] Size is not positive!");
+    } else if (size > sizeOfRegion) {
+        throw std::invalid_argument("[StreamingBuffer] Size is greater than size of region!");
+    }
+
+    // Move to next region and make sure GPU is done with it
+    region = (region + 1) % NUMBER_OF_REGIONS;
+    waitFor(region);
+
+    // Map it, no need for the driver to synchronize since fence was checked
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    GLvoid* const ptr = glMapBufferRange(GL_ARRAY_BUFFER, region * sizeOfRegion, size, access);
+    if (ptr == NULL) {
+        throw std::runtime_error("[StreamingBuffer] Could not map region!");
+    }
+    return ptr;
+}
+
+/**
+ * Unmaps the current region of the buffer.
+ *
+ * @return Offset in bytes of the region in the buffer
+ * @throws std::runtime_error if contents of the region were lost while mapped
+ */
+GLintptr StreamingBuffer::unmap() {
+    if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
+        throw std::runtime_error("[StreamingBuffer] Contents of region were lost!");
+    }
+    return region * sizeOfRegion;
+}
+
+/**
+ * Unbinds the buffer from the array buffer target.
+ */
+void StreamingBuffer::unbind() const {
+    arrayBuffer.unbind(vbo);
+}
+
+/**
+ * Waits for the GPU to finish with a region.
+ *
+ * @param region Index of region to wait for
+ * @throws std::runtime_error if waiting failed
+ */
+void StreamingBuffer::waitFor(const int region) {
+
+    // Skip if never fenced
+    GLsync fence = fences[region];
+    if (fence == NULL) {
+        return;
+    }
+
+    // Flush the first time in case the fence has not been sent yet
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, 0, TIMEOUT);
+    }
+    if (result == GL_WAIT_FAILED) {
+        throw std::runtime_error("[StreamingBuffer] Could not wait for region!");
+    }
+
+    // Done with the fence
+    glDeleteSync(fence);
+    fences[region] = NULL;
+}
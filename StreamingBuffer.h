@@ -0,0 +1,58 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_STREAMING_BUFFER_H
+#define GANDER_STREAMING_BUFFER_H
+#include <gloop/BufferObject.hxx>
+#include <gloop/BufferTarget.hxx>
+
+
+/**
+ * Array buffer streamed to through a ring of fenced regions.
+ *
+ * Each call to `map` hands out the next region of the buffer, after waiting
+ * for the GPU to finish any commands still reading from it.  Since the other
+ * regions are left alone, vertices for the next frame can be written while
+ * the GPU is still drawing the last one.
+ */
+class StreamingBuffer {
+public:
+// Methods
+    StreamingBuffer();
+    virtual ~StreamingBuffer();
+    void allocate(GLsizeiptr sizeOfRegion);
+    void bind() const;
+    void fence();
+    GLsizeiptr getSizeOfRegion() const;
+    GLvoid* map(GLsizeiptr size);
+    GLintptr unmap();
+    void unbind() const;
+private:
+// Constants
+    static const int NUMBER_OF_REGIONS = 3;
+    static const GLuint64 TIMEOUT = 1000000;
+// Attributes
+    const Gloop::BufferTarget arrayBuffer;
+    const Gloop::BufferObject vbo;
+    GLsizeiptr sizeOfRegion;
+    int region;
+    GLsync fences[NUMBER_OF_REGIONS];
+// Methods
+    void waitFor(int region);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <stdexcept>
+#include "TransferFunction.h"
+
+/**
+ * Reads a transfer function back from the texture bound to a texture unit.
+ *
+ * @param unit Ordinal of texture unit the transfer function is bound to
+ * @param entries Vector to store RGBA entries of the transfer function in
+ * @throws std::runtime_error if the texture unit has neither a 1D nor a 2D texture bound
+ */
+void TransferFunction::read(const GLint unit, std::vector<GLfloat>& entries) {
+
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+
+    // Try a 1D texture first
+    GLint width = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_1D, 0, GL_TEXTURE_WIDTH, &width);
+    if (width > 0) {
+        entries.resize(width * 4);
+        glGetTexImage(GL_TEXTURE_1D, 0, GL_RGBA, GL_FLOAT, &entries[0]);
+        glActiveTexture(activeTexture);
+        return;
+    }
+
+    // Otherwise use the first row of a 2D texture
+    GLint height = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    if ((width <= 0) || (height <= 0)) {
+        glActiveTexture(activeTexture);
+        throw std::runtime_error("[TransferFunction] Texture holds neither a 1D nor a 2D texture!");
+    }
+    std::vector<GLfloat> image(width * height * 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &image[0]);
+    entries.assign(image.begin(), image.begin() + width * 4);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Samples the opacities of a transfer function at evenly spaced values, like a linearly filtered texture.
+ *
+ * @param entries RGBA entries of the transfer function
+ * @param size Number of opacities to sample
+ * @param opacities Vector to store opacities in
+ * @throws std::invalid_argument if transfer function is not made of RGBA entries, or size is not positive
+ */
+void TransferFunction::resample(const std::vector<GLfloat>& entries,
+                                const int size,
+                                std::vector<float>& opacities) {
+
+    if (entries.empty() || ((entries.size() % 4) != 0)) {
+        throw std::invalid_argument("[TransferFunction] Transfer function must be made of RGBA entries!");
+    } else if (size <= 0) {
+        throw std::invalid_argument("[TransferFunction] Size must be positive!");
+    }
+
+    // Find each value's position between texel centers and interpolate
+    const int n = entries.size() / 4;
+    opacities.resize(size);
+    for (int i = 0; i < size; ++i) {
+        const float value = (size > 1) ? (((float) i) / (size - 1)) : 0;
+        float position = (value * n) - 0.5f;
+        position = (position > 0) ? ((position < (n - 1)) ? position : (n - 1)) : 0;
+        const int j = (int) position;
+        const int k = (j + 1 < n) ? (j + 1) : j;
+        const float t = position - j;
+        opacities[i] = entries[(j * 4) + 3] + (t * (entries[(k * 4) + 3] - entries[(j * 4) + 3]));
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_TRANSFER_FUNCTION_H
+#define GANDER_TRANSFER_FUNCTION_H
+#include <vector>
+#include <GL/glfw.h>
+
+
+/**
+ * Reads a one-dimensional transfer function back from a texture.
+ *
+ * The transfer function is either a 1D texture or the first row of a 2D texture, with opacity in alpha.
+ */
+class TransferFunction {
+public:
+// Methods
+    static void read(GLint unit, std::vector<GLfloat>& entries);
+    static void resample(const std::vector<GLfloat>& entries, int size, std::vector<float>& opacities);
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VolumeAtlas.h"
+
+/**
+ * Constructs an empty `VolumeAtlas`.
+ *
+ * @param unit Ordinal of texture unit to bind atlas to
+ * @throws std::invalid_argument if unit is negative
+ */
+VolumeAtlas::VolumeAtlas(const GLint unit) :
+        unit(unit),
+        texture(0),
+        internalFormat(GL_R8),
+        type(GL_UNSIGNED_BYTE),
+        bytesPerVoxel(1) {
+    if (unit < 0) {
+        throw std::invalid_argument("[VolumeAtlas] Texture unit is negative!");
+    }
+    size[0] = size[1] = size[2] = 0;
+}
+
+/**
+ * Deletes the atlas.
+ */
+VolumeAtlas::~VolumeAtlas() {
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+/**
+ * Binds the atlas to its texture unit.
+ */
+void VolumeAtlas::bind() const {
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Keeps an index inside an axis of a volume.
+ *
+ * @param value Index that may be off either end by the apron
+ * @param max Size of axis
+ * @return Nearest index inside the axis
+ */
+int VolumeAtlas::clamp(const int value, const int max) {
+    return (value < 0) ? 0 : ((value >= max) ? (max - 1) : value);
+}
+
+/**
+ * Finds how to store voxels of a texture in the atlas.
+ *
+ * Formats other than 16-bit and float ones, including compressed ones, are read back as bytes.
+ *
+ * @param internalFormat Internal format of texture holding volume
+ * @param type Type to read voxels back as
+ * @param bytesPerVoxel Size of each voxel read back
+ * @return Internal format to store voxels in the atlas with
+ */
+GLenum VolumeAtlas::findStorage(const GLenum internalFormat, GLenum& type, int& bytesPerVoxel) {
+    switch (internalFormat) {
+    case GL_R16:
+        type = GL_UNSIGNED_SHORT;
+        bytesPerVoxel = 2;
+        return GL_R16;
+    case GL_R16F:
+        type = GL_HALF_FLOAT;
+        bytesPerVoxel = 2;
+        return GL_R16F;
+    case GL_R32F:
+        type = GL_FLOAT;
+        bytesPerVoxel = 4;
+        return GL_R32F;
+    default:
+        type = GL_UNSIGNED_BYTE;
+        bytesPerVoxel = 1;
+        return GL_R8;
+    }
+}
+
+/**
+ * Finds how to take texture coordinates of a volume into the atlas.
+ *
+ * @param source Ordinal of texture unit the volume is bound to
+ * @param scale Amount to multiply each coordinate by
+ * @param offset Amount to add to each coordinate after scaling it
+ * @return `true` if the volume is in the atlas
+ */
+bool VolumeAtlas::findTransform(const GLint source, double scale[3], double offset[3]) const {
+    const std::map<GLint,Region>::const_iterator it = regionsBySource.find(source);
+    if (it == regionsBySource.end()) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        scale[i] = ((double) it->second.size[i]) / size[i];
+        offset[i] = ((double) it->second.origin[i]) / size[i];
+    }
+    return true;
+}
+
+/**
+ * Returns the ordinal of the texture unit the atlas is bound to.
+ */
+GLint VolumeAtlas::getUnit() const {
+    return unit;
+}
+
+/**
+ * Lays out volumes in the atlas and copies them in.
+ *
+ * @param sources Ordinals of texture units the volumes are bound to, which may repeat
+ * @throws std::runtime_error if a unit has no 3D texture, volumes are stored differently, or they don't fit
+ */
+void VolumeAtlas::pack(const std::vector<GLint>& sources) {
+
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+
+    // Stack volumes along Z, leaving room for aprons
+    regionsBySource.clear();
+    size[0] = size[1] = size[2] = 0;
+    for (std::vector<GLint>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+        if (regionsBySource.count(*it) > 0) {
+            continue;
+        }
+
+        // Find size and format of volume
+        Region region;
+        GLint format;
+        glActiveTexture(GL_TEXTURE0 + (*it));
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0, GL_TEXTURE_WIDTH, &region.size[0]);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0, GL_TEXTURE_HEIGHT, &region.size[1]);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0, GL_TEXTURE_DEPTH, &region.size[2]);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+        if ((region.size[0] <= 0) || (region.size[1] <= 0) || (region.size[2] <= 0)) {
+            glActiveTexture(activeTexture);
+            throw std::runtime_error("[VolumeAtlas] Texture unit has no 3D texture bound!");
+        }
+        GLenum typeOfVolume;
+        int bytesPerVoxelOfVolume;
+        const GLenum storage = findStorage(format, typeOfVolume, bytesPerVoxelOfVolume);
+        if (regionsBySource.empty()) {
+            internalFormat = storage;
+            type = typeOfVolume;
+            bytesPerVoxel = bytesPerVoxelOfVolume;
+        } else if (storage != internalFormat) {
+            glActiveTexture(activeTexture);
+            throw std::runtime_error("[VolumeAtlas] Volumes must all be stored the same way!");
+        }
+
+        // Put it on top of the last one
+        region.origin[0] = APRON;
+        region.origin[1] = APRON;
+        region.origin[2] = size[2] + APRON;
+        size[0] = std::max(size[0], region.size[0] + (2 * APRON));
+        size[1] = std::max(size[1], region.size[1] + (2 * APRON));
+        size[2] += region.size[2] + (2 * APRON);
+        regionsBySource[*it] = region;
+    }
+    glActiveTexture(activeTexture);
+
+    // Make sure it fits
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    if ((size[0] > maxSize) || (size[1] > maxSize) || (size[2] > maxSize)) {
+        throw std::runtime_error("[VolumeAtlas] Volumes are too large to fit in one texture!");
+    }
+
+    // Make atlas
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, size[0], size[1], size[2], 0, GL_RED, type, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glActiveTexture(activeTexture);
+
+    // Copy volumes in
+    for (std::map<GLint,Region>::const_iterator it = regionsBySource.begin(); it != regionsBySource.end(); ++it) {
+        refresh(it->first);
+    }
+}
+
+/**
+ * Copies a volume into the atlas again after its texture changed.
+ *
+ * @param source Ordinal of texture unit the volume is bound to
+ * @throws std::invalid_argument if volume was not packed into the atlas
+ */
+void VolumeAtlas::refresh(const GLint source) {
+
+    const std::map<GLint,Region>::const_iterator it = regionsBySource.find(source);
+    if (it == regionsBySource.end()) {
+        throw std::invalid_argument("[VolumeAtlas] Volume is not in atlas!");
+    }
+    const Region& region = it->second;
+    const int width = region.size[0];
+    const int height = region.size[1];
+    const int depth = region.size[2];
+
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+
+    // Read volume back
+    std::vector<unsigned char> voxels(((size_t) width) * height * depth * bytesPerVoxel);
+    glActiveTexture(GL_TEXTURE0 + source);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, type, &voxels[0]);
+
+    // Surround it with an apron repeating its edges
+    const int paddedWidth = width + (2 * APRON);
+    const int paddedHeight = height + (2 * APRON);
+    const int paddedDepth = depth + (2 * APRON);
+    std::vector<unsigned char> padded(((size_t) paddedWidth) * paddedHeight * paddedDepth * bytesPerVoxel);
+    unsigned char* voxel = &padded[0];
+    for (int k = 0; k < paddedDepth; ++k) {
+        const size_t z = clamp(k - APRON, depth);
+        for (int j = 0; j < paddedHeight; ++j) {
+            const size_t y = clamp(j - APRON, height);
+            const unsigned char* const row = &voxels[((z * height) + y) * width * bytesPerVoxel];
+            for (int i = 0; i < paddedWidth; ++i) {
+                memcpy(voxel, row + (clamp(i - APRON, width) * bytesPerVoxel), bytesPerVoxel);
+                voxel += bytesPerVoxel;
+            }
+        }
+    }
+
+    // Copy it into its region
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_3D, 0,
+                    region.origin[0] - APRON, region.origin[1] - APRON, region.origin[2] - APRON,
+                    paddedWidth, paddedHeight, paddedDepth,
+                    GL_RED, type, &padded[0]);
+    glActiveTexture(activeTexture);
+}
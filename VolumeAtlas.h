@@ -0,0 +1,71 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_VOLUME_ATLAS_H
+#define GANDER_VOLUME_ATLAS_H
+#include <map>
+#include <vector>
+#include <GL/glfw.h>
+
+
+/**
+ * Single 3D texture holding copies of several volumes, so they can all be sampled from one texture unit.
+ *
+ * Volumes are stacked along Z, each surrounded by an apron repeating its edge voxels so filtering never
+ * reaches into a neighbor.  A volume is copied in by reading its texture back from the unit it's bound to,
+ * which only has to happen again when the texture changes.  Every volume must be stored the same way, since
+ * they all share one internal format.
+ *
+ * The atlas doesn't replace the volumes' own textures.  Each volume still has to be bound to a texture unit
+ * of its own to be copied in, and its texture stays where it is, so the atlas holds a second copy of every
+ * volume on the GPU.  Since volumes are stacked, their depths plus aprons must also add up to no more than
+ * `GL_MAX_3D_TEXTURE_SIZE`.
+ */
+class VolumeAtlas {
+public:
+// Methods
+    VolumeAtlas(GLint unit);
+    virtual ~VolumeAtlas();
+    void bind() const;
+    bool findTransform(GLint source, double scale[3], double offset[3]) const;
+    GLint getUnit() const;
+    void pack(const std::vector<GLint>& sources);
+    void refresh(GLint source);
+private:
+// Constants
+    static const int APRON = 1;
+// Types
+    struct Region {
+        GLint origin[3];
+        GLint size[3];
+    };
+// Attributes
+    const GLint unit;
+    GLuint texture;
+    GLenum internalFormat;
+    GLenum type;
+    int bytesPerVoxel;
+    GLint size[3];
+    std::map<GLint,Region> regionsBySource;
+// Methods
+    VolumeAtlas(const VolumeAtlas&);
+    VolumeAtlas& operator=(const VolumeAtlas&);
+    static int clamp(int value, int max);
+    static GLenum findStorage(GLenum internalFormat, GLenum& type, int& bytesPerVoxel);
+};
+
+#endif
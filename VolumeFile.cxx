@@ -0,0 +1,345 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "VolumeFile.h"
+
+/**
+ * Maps a NRRD volume into memory.
+ *
+ * @param filename Path to NRRD file
+ * @throws std::runtime_error if file could not be mapped, its header is invalid, or it is too short
+ */
+VolumeFile::VolumeFile(const std::string& filename) :
+        fd(-1),
+        address(NULL),
+        length(0),
+        offset(0),
+        type(UNSIGNED_BYTE),
+        swapped(false) {
+    for (int i = 0; i < 3; ++i) {
+        size[i] = 0;
+    }
+    map(filename);
+    try {
+        parseHeader();
+        check();
+    } catch (std::exception&) {
+        unmap();
+        throw;
+    }
+}
+
+/**
+ * Maps a raw volume into memory.
+ *
+ * Voxels wider than a byte are assumed to be in the byte order of this machine.
+ *
+ * @param filename Path to raw file
+ * @param width Number of voxels in X
+ * @param height Number of voxels in Y
+ * @param depth Number of voxels in Z
+ * @param type Type of each voxel
+ * @throws std::invalid_argument if any size is not positive
+ * @throws std::runtime_error if file could not be mapped or is too short
+ */
+VolumeFile::VolumeFile(const std::string& filename,
+                       const int width,
+                       const int height,
+                       const int depth,
+                       const Type type) :
+        fd(-1),
+        address(NULL),
+        length(0),
+        offset(0),
+        type(type),
+        swapped(false) {
+    if ((width <= 0) || (height <= 0) || (depth <= 0)) {
+        throw std::invalid_argument("[VolumeFile] Size of volume must be positive!");
+    }
+    size[0] = width;
+    size[1] = height;
+    size[2] = depth;
+    map(filename);
+    try {
+        check();
+    } catch (std::exception&) {
+        unmap();
+        throw;
+    }
+}
+
+/**
+ * Unmaps the volume.
+ */
+VolumeFile::~VolumeFile() {
+    unmap();
+}
+
+/**
+ * Makes sure the file holds every voxel of the volume.
+ *
+ * @throws std::runtime_error if the file is too short
+ */
+void VolumeFile::check() const {
+    if ((length - offset) < (getSizeOfLayer() * size[2])) {
+        throw std::runtime_error("[VolumeFile] File is smaller than its volume!");
+    }
+}
+
+/**
+ * Returns the number of bytes in each voxel.
+ */
+int VolumeFile::getBytesPerVoxel() const {
+    switch (type) {
+    case UNSIGNED_SHORT:
+        return 2;
+    case FLOAT:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Returns the first voxel of the volume.
+ */
+const unsigned char* VolumeFile::getData() const {
+    return address + offset;
+}
+
+/**
+ * Returns the first voxel of a layer of the volume.
+ *
+ * @param z Index of layer
+ */
+const unsigned char* VolumeFile::getLayer(const int z) const {
+    return getData() + (getSizeOfLayer() * z);
+}
+
+/**
+ * Returns the number of voxels along an axis of the volume.
+ *
+ * @param axis Index of axis, where 0 is X, 1 is Y, and 2 is Z
+ */
+int VolumeFile::getSize(const int axis) const {
+    return size[axis];
+}
+
+/**
+ * Returns the number of bytes in each layer of the volume.
+ */
+size_t VolumeFile::getSizeOfLayer() const {
+    return ((size_t) size[0]) * size[1] * getBytesPerVoxel();
+}
+
+/**
+ * Returns the type of each voxel.
+ */
+VolumeFile::Type VolumeFile::getType() const {
+    return type;
+}
+
+/**
+ * Checks if this machine stores the most significant byte first.
+ */
+bool VolumeFile::isBigEndian() {
+    const unsigned short value = 1;
+    return *((const unsigned char*) &value) == 0;
+}
+
+/**
+ * Checks if voxels in the file are in the opposite byte order of this machine.
+ */
+bool VolumeFile::isSwapped() const {
+    return swapped;
+}
+
+/**
+ * Maps a file into memory for reading, expecting it to be read from front to back.
+ *
+ * @param filename Path to file
+ * @throws std::runtime_error if file could not be opened or mapped
+ */
+void VolumeFile::map(const std::string& filename) {
+
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("[VolumeFile] Could not open file!");
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (info.st_size <= 0)) {
+        close(fd);
+        throw std::runtime_error("[VolumeFile] Could not find size of file!");
+    }
+    length = info.st_size;
+
+    void* const ptr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("[VolumeFile] Could not map file!");
+    }
+    address = (unsigned char*) ptr;
+    posix_madvise(address, length, POSIX_MADV_SEQUENTIAL);
+}
+
+/**
+ * Reads the header at the start of a NRRD file, finding where the voxels start.
+ *
+ * @throws std::runtime_error if header is missing, incomplete, or describes a volume that isn't supported
+ */
+void VolumeFile::parseHeader() {
+
+    // Check magic
+    if ((length < 4) || (memcmp(address, "NRRD", 4) != 0)) {
+        throw std::runtime_error("[VolumeFile] File is not a NRRD file!");
+    }
+
+    // Read fields up to the blank line
+    std::string typeName, encoding, endian;
+    int dimension = 0;
+    size_t position = 0;
+    bool ended = false;
+    bool first = true;
+    while (!ended && (position < length)) {
+        const unsigned char* const end = (const unsigned char*) memchr(address + position, '\n', length - position);
+        if (end == NULL) {
+            break;
+        }
+        const std::string line = trim(std::string((const char*) address + position, (const char*) end));
+        position = (end - address) + 1;
+        if (first) {
+            first = false;
+            continue;
+        } else if (line.empty()) {
+            ended = true;
+            continue;
+        } else if (line[0] == '#') {
+            continue;
+        }
+
+        // Split field into key and value, skipping key/value pairs
+        const size_t colon = line.find(": ");
+        if ((colon == std::string::npos) || (line.find(":=") != std::string::npos)) {
+            continue;
+        }
+        const std::string key = line.substr(0, colon);
+        const std::string value = trim(line.substr(colon + 2));
+        if (key == "type") {
+            typeName = value;
+        } else if (key == "dimension") {
+            std::istringstream(value) >> dimension;
+        } else if (key == "sizes") {
+            std::istringstream stream(value);
+            stream >> size[0] >> size[1] >> size[2];
+        } else if (key == "encoding") {
+            encoding = value;
+        } else if (key == "endian") {
+            endian = value;
+        } else if ((key == "data file") || (key == "datafile")) {
+            throw std::runtime_error("[VolumeFile] Detached data files are not supported!");
+        }
+    }
+    if (!ended) {
+        throw std::runtime_error("[VolumeFile] Header of NRRD file is incomplete!");
+    }
+    offset = position;
+
+    // Check fields
+    if (dimension != 3) {
+        throw std::runtime_error("[VolumeFile] Only 3D volumes are supported!");
+    } else if ((size[0] <= 0) || (size[1] <= 0) || (size[2] <= 0)) {
+        throw std::runtime_error("[VolumeFile] Sizes of volume are invalid!");
+    } else if (encoding != "raw") {
+        throw std::runtime_error("[VolumeFile] Only raw encoding is supported!");
+    }
+    if ((typeName == "uchar") || (typeName == "unsigned char") || (typeName == "uint8")
+            || (typeName == "uint8_t")) {
+        type = UNSIGNED_BYTE;
+    } else if ((typeName == "ushort") || (typeName == "unsigned short") || (typeName == "unsigned short int")
+            || (typeName == "uint16") || (typeName == "uint16_t")) {
+        type = UNSIGNED_SHORT;
+    } else if (typeName == "float") {
+        type = FLOAT;
+    } else {
+        throw std::runtime_error("[VolumeFile] Only unsigned 8 and 16-bit or float voxels are supported!");
+    }
+    if (type != UNSIGNED_BYTE) {
+        if ((endian != "big") && (endian != "little")) {
+            throw std::runtime_error("[VolumeFile] Endian of voxels is unspecified!");
+        }
+        swapped = (endian == "big") != isBigEndian();
+    }
+}
+
+/**
+ * Hints that some layers will be read soon, so the system can start reading them from disk.
+ *
+ * @param first Index of first layer
+ * @param count Number of layers, which is clamped to the volume
+ */
+void VolumeFile::prefetch(const int first, int count) const {
+    if (first >= size[2]) {
+        return;
+    } else if ((first + count) > size[2]) {
+        count = size[2] - first;
+    }
+
+    // Round start down to a page, since the mapping is only aligned to pages
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t start = offset + (getSizeOfLayer() * first);
+    const size_t aligned = start - (start % pageSize);
+    posix_madvise(address + aligned, (start - aligned) + (getSizeOfLayer() * count), POSIX_MADV_WILLNEED);
+}
+
+/**
+ * Removes leading and trailing whitespace from a string.
+ *
+ * @param str String to trim
+ * @return Copy of string without whitespace at either end
+ */
+std::string VolumeFile::trim(const std::string& str) {
+    const char* const whitespace = " \t\r\n";
+    const size_t begin = str.find_first_not_of(whitespace);
+    if (begin == std::string::npos) {
+        return "";
+    }
+    const size_t end = str.find_last_not_of(whitespace);
+    return str.substr(begin, (end - begin) + 1);
+}
+
+/**
+ * Unmaps the file and closes it.
+ */
+void VolumeFile::unmap() {
+    if (address != NULL) {
+        munmap(address, length);
+        address = NULL;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
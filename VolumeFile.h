@@ -0,0 +1,71 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_VOLUME_FILE_H
+#define GANDER_VOLUME_FILE_H
+#include <cstddef>
+#include <string>
+
+
+/**
+ * Raw or NRRD volume mapped into memory.
+ *
+ * Voxels are read straight out of the mapping, so the only copy made is into wherever they go next, and
+ * pages are only read from disk as they are touched.  NRRD files must use raw encoding with the data in the
+ * same file.  Voxels are 8 or 16-bit unsigned integers or 32-bit floats with X varying fastest.
+ */
+class VolumeFile {
+public:
+// Types
+    enum Type {
+        UNSIGNED_BYTE,
+        UNSIGNED_SHORT,
+        FLOAT
+    };
+// Methods
+    explicit VolumeFile(const std::string& filename);
+    VolumeFile(const std::string& filename, int width, int height, int depth, Type type);
+    virtual ~VolumeFile();
+    int getBytesPerVoxel() const;
+    const unsigned char* getData() const;
+    const unsigned char* getLayer(int z) const;
+    int getSize(int axis) const;
+    size_t getSizeOfLayer() const;
+    Type getType() const;
+    bool isSwapped() const;
+    void prefetch(int first, int count) const;
+private:
+// Attributes
+    int fd;
+    unsigned char* address;
+    size_t length;
+    size_t offset;
+    int size[3];
+    Type type;
+    bool swapped;
+// Methods
+    VolumeFile(const VolumeFile&);
+    VolumeFile& operator=(const VolumeFile&);
+    void check() const;
+    static bool isBigEndian();
+    void map(const std::string& filename);
+    void parseHeader();
+    static std::string trim(const std::string& str);
+    void unmap();
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "config.h"
 #include <stdexcept>
 #include <m3d/Vec4.h>
+#include "TransferFunction.h"
 #include "VolumeNode.h"
 
 // Bounding box for intersection tests
@@ -29,15 +30,63 @@ const Glycerin::AxisAlignedBoundingBox VolumeNode::BOUNDING_BOX = VolumeNode::cr
  * @param textureId Identifier of texture node
  * @throws std::invalid_argument if ID of texture node is `null`
  */
-VolumeNode::VolumeNode(const std::string& textureId) : textureId(textureId) {
+VolumeNode::VolumeNode(const std::string& textureId) :
+        textureId(textureId),
+        brickCache(NULL),
+        volumeUploader(NULL),
+        gradientVolume(NULL),
+        transferNode(NULL),
+        transferChanged(false) {
     // empty
 }
 
 /**
- * Destructs a `VolumeNode`.
+ * Constructs a `VolumeNode` streamed in bricks from disk.
+ *
+ * @param brickCache Cache of bricks in the GPU, which the node takes ownership of
+ * @throws std::invalid_argument if brick cache is `NULL`
+ */
+VolumeNode::VolumeNode(BrickCache* const brickCache) :
+        brickCache(brickCache),
+        volumeUploader(NULL),
+        gradientVolume(NULL),
+        transferNode(NULL),
+        transferChanged(false) {
+    if (brickCache == NULL) {
+        throw std::invalid_argument("[VolumeNode] Brick cache is NULL!");
+    }
+}
+
+/**
+ * Constructs a `VolumeNode` uploaded from a file into its own texture.
+ *
+ * @param volumeUploader Uploader filling the texture, which the node takes ownership of
+ * @param gradientVolume Gradients of the volume, or `NULL` for none, which the node takes ownership of
+ * @throws std::invalid_argument if volume uploader is `NULL`
+ */
+VolumeNode::VolumeNode(VolumeUploader* const volumeUploader, GradientVolume* const gradientVolume) :
+        brickCache(NULL),
+        volumeUploader(volumeUploader),
+        gradientVolume(gradientVolume),
+        transferNode(NULL),
+        transferChanged(false) {
+    if (volumeUploader == NULL) {
+        delete gradientVolume;
+        throw std::invalid_argument("[VolumeNode] Volume uploader is NULL!");
+    }
+    volumeUploader->setOccupancyGrid(&occupancyGrid);
+}
+
+/**
+ * Destructs a `VolumeNode`, no longer listening to its transfer function.
  */
 VolumeNode::~VolumeNode() {
-    // empty
+    if (transferNode != NULL) {
+        transferNode->removeNodeListener(this);
+    }
+    delete brickCache;
+    delete volumeUploader;
+    delete gradientVolume;
 }
 
 /**
@@ -49,25 +98,172 @@ Glycerin::AxisAlignedBoundingBox VolumeNode::createBoundingBox() {
     return Glycerin::AxisAlignedBoundingBox(min, max);
 }
 
+/**
+ * Returns the cache of bricks this volume is streamed through, or `NULL` if it is held in a texture node.
+ */
+BrickCache* VolumeNode::getBrickCache() const {
+    return brickCache;
+}
+
+/**
+ * Returns the ordinal of the texture unit this volume binds its gradients to.
+ *
+ * @return Ordinal of texture unit, or -1 if the volume has no gradients
+ */
+GLint VolumeNode::getGradientUnit() const {
+    return (gradientVolume != NULL) ? gradientVolume->getUnit() : -1;
+}
+
+/**
+ * Returns the grid of bricks recording which parts of this volume can be seen.
+ *
+ * The grid is empty until a renderer builds it from the volume's texture.
+ */
+OccupancyGrid& VolumeNode::getOccupancyGrid() {
+    return occupancyGrid;
+}
+
+/**
+ * Returns the opacity of each value in this volume, or an empty vector if they are unknown.
+ */
+const std::vector<float>& VolumeNode::getOpacities() const {
+    return opacities;
+}
+
 /**
  * Returns the identifier of the texture to use for this volume.
  *
- * @return Identifier of the texture to use for this volume
+ * @return Identifier of the texture to use for this volume, or an empty string if it has its own texture
  */
 std::string VolumeNode::getTextureId() const {
     return textureId;
 }
 
+/**
+ * Returns the identifier of the texture node holding the transfer function opacities are read from.
+ *
+ * @return Identifier of the texture node, or an empty string if opacities are given directly
+ */
+std::string VolumeNode::getTransferId() const {
+    return transferId;
+}
+
+/**
+ * Returns the ordinal of the texture unit this volume binds its own texture to.
+ *
+ * @return Ordinal of texture unit, or -1 if the volume is held in a texture node
+ */
+GLint VolumeNode::getUnit() const {
+    if (brickCache != NULL) {
+        return brickCache->getUnit();
+    } else if (volumeUploader != NULL) {
+        return volumeUploader->getUnit();
+    } else {
+        return -1;
+    }
+}
+
+/**
+ * Returns the uploader filling this volume's texture, or `NULL` if it is held in a texture node or streamed in
+ * bricks.
+ */
+VolumeUploader* VolumeNode::getVolumeUploader() const {
+    return volumeUploader;
+}
+
 double VolumeNode::intersect(const Glycerin::Ray& ray) const {
     return BOUNDING_BOX.intersect(ray);
 }
 
+/**
+ * Reads the opacities again before the next visit when the transfer function changes.
+ *
+ * @param node Node that changed
+ */
+void VolumeNode::nodeChanged(RapidGL::Node* node) {
+    transferChanged = true;
+}
+
 void VolumeNode::postVisit(RapidGL::State& state) {
     // empty
 }
 
+/**
+ * Sends more of the volume to the GPU, and notifies listeners if bricks were added or the upload finished.
+ *
+ * Gradients are computed a slab per visit after the upload finishes, so the first frames aren't held up by
+ * them.  Also binds the gradients in case something else was bound to their texture unit, and reads the opacities
+ * from the transfer function the first time or after it changes.
+ *
+ * @throws std::runtime_error if the texture node holding the transfer function could not be found
+ */
 void VolumeNode::preVisit(RapidGL::State& state) {
-    // empty
+
+    // Find transfer function the first time
+    if (!transferId.empty() && (transferNode == NULL)) {
+        transferNode = RapidGL::findAncestor<RapidGL::TextureNode>(this, transferId);
+        if (transferNode == NULL) {
+            throw std::runtime_error("[VolumeNode] Could not find texture node of transfer function!");
+        }
+        transferNode->addNodeListener(this);
+        transferChanged = true;
+    }
+
+    // Read opacities if it changed
+    if (transferChanged) {
+        std::vector<GLfloat> entries;
+        std::vector<float> opacities;
+        TransferFunction::read(transferNode->getTextureUnit().toOrdinal(), entries);
+        TransferFunction::resample(entries, OccupancyGrid::NUMBER_OF_BINS, opacities);
+        setOpacities(opacities);
+        transferChanged = false;
+    }
+
+    // Update textures, computing gradients once the volume itself is in
+    if (gradientVolume != NULL) {
+        gradientVolume->bind();
+    }
+    if ((brickCache != NULL) && brickCache->update()) {
+        fireNodeChangedEvent();
+    } else if ((volumeUploader != NULL) && volumeUploader->update()) {
+        fireNodeChangedEvent();
+    } else if ((gradientVolume != NULL) && volumeUploader->isComplete() && gradientVolume->update()) {
+        fireNodeChangedEvent();
+    }
+}
+
+/**
+ * Changes the opacity of each value in this volume, and notifies listeners.
+ *
+ * Renderers use the opacities to skip parts of the volume that can't be seen, so they should match the
+ * transfer function in the shader.  Only occupancy of bricks whose values overlap the opacities that changed
+ * is looked at again.
+ *
+ * @param opacities Opacity of each value, with `OccupancyGrid::NUMBER_OF_BINS` entries, or empty if unknown
+ * @throws std::invalid_argument if opacities has the wrong number of entries
+ */
+void VolumeNode::setOpacities(const std::vector<float>& opacities) {
+    if (!opacities.empty()) {
+        occupancyGrid.update(opacities);
+    }
+    this->opacities = opacities;
+    fireNodeChangedEvent();
+}
+
+/**
+ * Changes the texture node holding the transfer function opacities are read from.
+ *
+ * The texture node must be above this volume, and is looked up on the next visit.
+ *
+ * @param transferId Identifier of the texture node, or an empty string to use opacities given directly
+ */
+void VolumeNode::setTransferId(const std::string& transferId) {
+    if (transferNode != NULL) {
+        transferNode->removeNodeListener(this);
+        transferNode = NULL;
+    }
+    this->transferId = transferId;
+    transferChanged = false;
 }
 
 void VolumeNode::visit(RapidGL::State& state) {
@@ -18,33 +18,72 @@
 #ifndef GANDER_VOLUME_NODE_H
 #define GANDER_VOLUME_NODE_H
 #include <string>
+#include <vector>
 #include <glycerin/AxisAlignedBoundingBox.hxx>
 #include <RapidGL/Intersectable.h>
 #include <RapidGL/Node.h>
 #include <RapidGL/State.h>
+#include <RapidGL/TextureNode.h>
+#include "BrickCache.h"
+#include "GradientVolume.h"
+#include "OccupancyGrid.h"
+#include "VolumeUploader.h"
 
 
 /**
  * Node representing a volume.
  *
  * Note that `Volume` may not be used for all types of volume rendering.
+ *
+ * A volume either names a texture node holding all of it, uploads a raw or NRRD file into its own texture
+ * through a `VolumeUploader`, or streams bricks of a larger volume from disk through a `BrickCache`.  The
+ * volume owns its uploader or cache.  An uploaded volume may also have a `GradientVolume` on a second texture
+ * unit, which shaders can sample for normals instead of taking differences themselves, filled in once the
+ * volume itself has been uploaded.
+ *
+ * Renderers skip parts of the volume its opacities say can't be seen.  The opacities are either given
+ * directly, or read back from a transfer function in a texture node above the volume, in which case they are
+ * read again whenever the texture node reports a change.  Only uploaded volumes have an occupancy grid, which
+ * is filled from the file a slab at a time as the volume is uploaded, so the texture is never read back.
  */
-class VolumeNode : public RapidGL::Node, public RapidGL::Intersectable {
+class VolumeNode : public RapidGL::Node, public RapidGL::Intersectable, public RapidGL::NodeListener {
 public:
 // Methods
     VolumeNode(const std::string& textureId);
+    explicit VolumeNode(BrickCache* brickCache);
+    explicit VolumeNode(VolumeUploader* volumeUploader, GradientVolume* gradientVolume = NULL);
     virtual ~VolumeNode();
+    BrickCache* getBrickCache() const;
+    GLint getGradientUnit() const;
+    OccupancyGrid& getOccupancyGrid();
+    const std::vector<float>& getOpacities() const;
     std::string getTextureId() const;
+    std::string getTransferId() const;
+    GLint getUnit() const;
+    VolumeUploader* getVolumeUploader() const;
     virtual double intersect(const Glycerin::Ray& ray) const;
+    virtual void nodeChanged(RapidGL::Node* node);
     virtual void postVisit(RapidGL::State& state);
     virtual void preVisit(RapidGL::State& state);
+    void setOpacities(const std::vector<float>& opacities);
+    void setTransferId(const std::string& transferId);
     virtual void visit(RapidGL::State& state);
 private:
 // Constants
     static const Glycerin::AxisAlignedBoundingBox BOUNDING_BOX;
 // Attributes
     const std::string textureId;
+    BrickCache* const brickCache;
+    VolumeUploader* const volumeUploader;
+    GradientVolume* const gradientVolume;
+    std::vector<float> opacities;
+    OccupancyGrid occupancyGrid;
+    std::string transferId;
+    RapidGL::TextureNode* transferNode;
+    bool transferChanged;
 // Methods
+    VolumeNode(const VolumeNode&);
+    VolumeNode& operator=(const VolumeNode&);
     static Glycerin::AxisAlignedBoundingBox createBoundingBox();
 };
 
@@ -32,6 +32,158 @@ VolumeNodeUnmarshaller::~VolumeNodeUnmarshaller() {
     // empty
 }
 
+/**
+ * Determines the value of the _capacity_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Number of bytes the atlas may use, or `DEFAULT_CAPACITY` megabytes if unspecified
+ * @throws std::runtime_error if capacity is not positive
+ */
+size_t VolumeNodeUnmarshaller::getCapacity(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "capacity");
+    const int capacity = value.empty() ? DEFAULT_CAPACITY : parseInt(value);
+    if (capacity <= 0) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Capacity must be positive!");
+    }
+    return capacity * BYTES_PER_MEGABYTE;
+}
+
+/**
+ * Determines the value of the _format_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Format of file, where `bricks` is the default
+ * @throws std::runtime_error if format is not `bricks`, `nrrd`, or `raw`
+ */
+std::string VolumeNodeUnmarshaller::getFormat(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "format");
+    if (value.empty()) {
+        return "bricks";
+    } else if ((value != "bricks") && (value != "nrrd") && (value != "raw")) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Format must be 'bricks', 'nrrd', or 'raw'!");
+    }
+    return value;
+}
+
+/**
+ * Determines the value of the _gradient_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @param unit Ordinal of texture unit the volume itself is bound to
+ * @return Ordinal of texture unit to bind gradients to, or -1 if unspecified
+ * @throws std::runtime_error if gradient is negative or the same as the volume's unit
+ */
+GLint VolumeNodeUnmarshaller::getGradient(const std::map<std::string,std::string>& attributes, const GLint unit) {
+    const std::string value = findValue(attributes, "gradient");
+    if (value.empty()) {
+        return -1;
+    }
+    const GLint gradient = parseInt(value);
+    if (gradient < 0) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Gradient must not be negative!");
+    } else if (gradient == unit) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Gradient must not share the unit of the volume!");
+    }
+    return gradient;
+}
+
+/**
+ * Determines the value of the _opacity_ attribute in a map of XML attributes.
+ *
+ * The attribute lists pairs of values and opacities, in increasing order of value, which are linearly
+ * interpolated into a table.  Values before the first pair or after the last take their opacity.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Table of opacities with `OccupancyGrid::NUMBER_OF_BINS` entries, or empty if unspecified
+ * @throws std::runtime_error if the attribute doesn't hold pairs of increasing values
+ */
+std::vector<float> VolumeNodeUnmarshaller::getOpacities(const std::map<std::string,std::string>& attributes) {
+
+    // Get value
+    const std::string value = findValue(attributes, "opacity");
+    if (value.empty()) {
+        return std::vector<float>();
+    }
+
+    // Parse pairs
+    const std::vector<std::string> tokens = tokenize(value);
+    if (tokens.empty() || ((tokens.size() % 2) != 0)) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Opacity must be pairs of values and opacities!");
+    }
+    std::vector<float> values;
+    std::vector<float> opacities;
+    for (size_t i = 0; i < tokens.size(); i += 2) {
+        values.push_back(parseFloat(tokens[i]));
+        opacities.push_back(parseFloat(tokens[i + 1]));
+        if ((values.size() > 1) && (values[values.size() - 1] < values[values.size() - 2])) {
+            throw std::runtime_error("[VolumeNodeUnmarshaller] Opacity values must increase!");
+        }
+    }
+
+    // Fill table
+    std::vector<float> table(OccupancyGrid::NUMBER_OF_BINS);
+    size_t j = 0;
+    for (int i = 0; i < OccupancyGrid::NUMBER_OF_BINS; ++i) {
+        const float x = ((float) i) / (OccupancyGrid::NUMBER_OF_BINS - 1);
+        while ((j < values.size()) && (values[j] < x)) {
+            ++j;
+        }
+        if (j == 0) {
+            table[i] = opacities.front();
+        } else if (j == values.size()) {
+            table[i] = opacities.back();
+        } else {
+            const float t = (x - values[j - 1]) / (values[j] - values[j - 1]);
+            table[i] = opacities[j - 1] + (t * (opacities[j] - opacities[j - 1]));
+        }
+    }
+    return table;
+}
+
+/**
+ * Determines the value of the _report_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return `true` to print the error made converting voxels, where `false` is the default
+ * @throws std::runtime_error if report is not `true` or `false`
+ */
+bool VolumeNodeUnmarshaller::getReport(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "report");
+    if (value.empty() || (value == "false")) {
+        return false;
+    } else if (value == "true") {
+        return true;
+    } else {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Report is invalid!");
+    }
+}
+
+/**
+ * Determines the value of the _storage_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @param type Type of voxels in file, which picks the storage if unspecified
+ * @return Storage to keep the texture in
+ * @throws std::runtime_error if storage is not `r8`, `r16`, `r16f`, or `compressed`
+ */
+Quantizer::Storage VolumeNodeUnmarshaller::getStorage(const std::map<std::string,std::string>& attributes,
+                                                      const VolumeFile::Type type) {
+    const std::string value = findValue(attributes, "storage");
+    if (value.empty()) {
+        return Quantizer::getStorage(type);
+    } else if (value == "r8") {
+        return Quantizer::R8;
+    } else if (value == "r16") {
+        return Quantizer::R16;
+    } else if (value == "r16f") {
+        return Quantizer::R16F;
+    } else if (value == "compressed") {
+        return Quantizer::COMPRESSED;
+    } else {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Storage must be 'r8', 'r16', 'r16f', or 'compressed'!");
+    }
+}
+
 /**
  * Determines the value of the _texture_ attribute in a map of XML attributes.
  *
@@ -47,6 +199,82 @@ std::string VolumeNodeUnmarshaller::getTexture(const std::map<std::string,std::s
     return value;
 }
 
+/**
+ * Determines the value of the _transfer_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Identifier of texture node holding the transfer function, or an empty string if unspecified or
+ *         overridden by _opacity_
+ */
+std::string VolumeNodeUnmarshaller::getTransfer(const std::map<std::string,std::string>& attributes) {
+    if (!findValue(attributes, "opacity").empty()) {
+        return "";
+    }
+    return findValue(attributes, "transfer");
+}
+
+/**
+ * Determines the value of the _type_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Type of each voxel, where `uchar` is the default
+ * @throws std::runtime_error if type is not `uchar`, `ushort`, or `float`
+ */
+VolumeFile::Type VolumeNodeUnmarshaller::getType(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "type");
+    if (value.empty() || (value == "uchar")) {
+        return VolumeFile::UNSIGNED_BYTE;
+    } else if (value == "ushort") {
+        return VolumeFile::UNSIGNED_SHORT;
+    } else if (value == "float") {
+        return VolumeFile::FLOAT;
+    } else {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Type must be 'uchar', 'ushort', or 'float'!");
+    }
+}
+
+/**
+ * Determines the value of the _unit_ attribute in a map of XML attributes.
+ *
+ * @param attributes Map of XML attributes to look in
+ * @return Ordinal of texture unit
+ * @throws std::runtime_error if unit is unspecified or negative
+ */
+GLint VolumeNodeUnmarshaller::getUnit(const std::map<std::string,std::string>& attributes) {
+    const std::string value = findValue(attributes, "unit");
+    if (value.empty()) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Unit is unspecified!");
+    }
+    const GLint unit = parseInt(value);
+    if (unit < 0) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Unit must not be negative!");
+    }
+    return unit;
+}
+
+/**
+ * Maps a NRRD or raw volume file into memory.
+ *
+ * @param file Path to file
+ * @param format Either `nrrd` or `raw`
+ * @param attributes Map of XML attributes to find the size and type of a raw file in
+ * @return Pointer to the new `VolumeFile`
+ * @throws std::runtime_error if size of a raw file is not three numbers, or if file could not be mapped
+ */
+VolumeFile* VolumeNodeUnmarshaller::openVolumeFile(const std::string& file,
+                                                   const std::string& format,
+                                                   const std::map<std::string,std::string>& attributes) {
+    if (format == "nrrd") {
+        return new VolumeFile(file);
+    }
+    const std::vector<std::string> tokens = tokenize(findValue(attributes, "size"));
+    if (tokens.size() != 3) {
+        throw std::runtime_error("[VolumeNodeUnmarshaller] Size must be three numbers!");
+    }
+    const VolumeFile::Type type = getType(attributes);
+    return new VolumeFile(file, parseInt(tokens[0]), parseInt(tokens[1]), parseInt(tokens[2]), type);
+}
+
 /**
  * Creates a `VolumeNode` from a map of XML attributes.
  *
@@ -55,6 +283,40 @@ std::string VolumeNodeUnmarshaller::getTexture(const std::map<std::string,std::s
  * @throws std::runtime_error if any required attribute is missing, or if an attribute is invalid
  */
 RapidGL::Node* VolumeNodeUnmarshaller::unmarshal(const std::map<std::string,std::string>& attributes) {
-    const std::string texture = getTexture(attributes);
-    return new VolumeNode(texture);
+    const std::string file = findValue(attributes, "file");
+    const std::vector<float> opacities = getOpacities(attributes);
+    VolumeNode* volumeNode;
+    if (file.empty()) {
+        volumeNode = new VolumeNode(getTexture(attributes));
+    } else if (getFormat(attributes) == "bricks") {
+        volumeNode = new VolumeNode(new BrickCache(file, getUnit(attributes), getCapacity(attributes)));
+    } else {
+        const GLint unit = getUnit(attributes);
+        const GLint gradient = getGradient(attributes, unit);
+        const bool report = getReport(attributes);
+        WorkerPool& workerPool = WorkerPool::getInstance();
+        VolumeFile* const volumeFile = openVolumeFile(file, getFormat(attributes), attributes);
+        Quantizer::Storage storage;
+        try {
+            storage = getStorage(attributes, volumeFile->getType());
+        } catch (std::exception&) {
+            delete volumeFile;
+            throw;
+        }
+        VolumeUploader* const volumeUploader = new VolumeUploader(volumeFile, unit, storage, report, workerPool);
+        GradientVolume* gradientVolume = NULL;
+        if (gradient >= 0) {
+            try {
+                const Quantizer& quantizer = volumeUploader->getQuantizer();
+                gradientVolume = new GradientVolume(*volumeFile, quantizer, gradient, workerPool);
+            } catch (std::exception&) {
+                delete volumeUploader;
+                throw;
+            }
+        }
+        volumeNode = new VolumeNode(volumeUploader, gradientVolume);
+    }
+    volumeNode->setOpacities(opacities);
+    volumeNode->setTransferId(getTransfer(attributes));
+    return volumeNode;
 }
@@ -19,6 +19,7 @@
 #define GANDER_VOLUME_NODE_UNMARSHALLER_H
 #include <map>
 #include <string>
+#include <vector>
 #include <RapidGL/Node.h>
 #include <RapidGL/Unmarshaller.h>
 #include "VolumeNode.h"
@@ -27,6 +28,22 @@
 
 /**
  * Unmarshaller for a `VolumeNode`.
+ *
+ * A volume held in a texture node is given by _texture_.  A volume with its own texture is instead given by
+ * _file_, along with _unit_, the texture unit to bind it to, and _format_, which is one of
+ *
+ * - `bricks`, the default, for a brick file streamed through an atlas of at most _capacity_ megabytes
+ * - `nrrd`, for a NRRD file uploaded whole
+ * - `raw`, for a raw file uploaded whole, whose _size_ is three numbers and whose _type_ is `uchar`,
+ *   `ushort`, or `float`
+ *
+ * Uploaded files may also give _storage_, one of `r8`, `r16`, `r16f`, or `compressed`, to keep the texture
+ * in, _report_ to print the error made converting voxels to it, and _gradient_, a second texture unit to bind
+ * the gradients of the volume to, which are computed while it is loaded.
+ *
+ * Any volume may give _transfer_, the identifier of a texture node above it holding the transfer function,
+ * whose opacities are read back to skip parts of the volume that can't be seen.  An _opacity_ attribute
+ * overrides it with fixed opacities.
  */
 class VolumeNodeUnmarshaller : public RapidGL::Unmarshaller {
 public:
@@ -35,8 +52,23 @@ public:
     virtual ~VolumeNodeUnmarshaller();
     virtual RapidGL::Node* unmarshal(const std::map<std::string,std::string>& attributes);
 private:
+// Constants
+    static const int DEFAULT_CAPACITY = 256;
+    static const size_t BYTES_PER_MEGABYTE = 1024 * 1024;
 // Methods
+    size_t getCapacity(const std::map<std::string,std::string>& attributes);
+    std::string getFormat(const std::map<std::string,std::string>& attributes);
+    GLint getGradient(const std::map<std::string,std::string>& attributes, GLint unit);
+    std::vector<float> getOpacities(const std::map<std::string,std::string>& attributes);
+    bool getReport(const std::map<std::string,std::string>& attributes);
+    Quantizer::Storage getStorage(const std::map<std::string,std::string>& attributes, VolumeFile::Type type);
     std::string getTexture(const std::map<std::string,std::string>& attributes);
+    std::string getTransfer(const std::map<std::string,std::string>& attributes);
+    VolumeFile::Type getType(const std::map<std::string,std::string>& attributes);
+    GLint getUnit(const std::map<std::string,std::string>& attributes);
+    VolumeFile* openVolumeFile(const std::string& file,
+                               const std::string& format,
+                               const std::map<std::string,std::string>& attributes);
 };
 
 #endif
@@ -0,0 +1,309 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "OccupancyGrid.h"
+#include "VolumeUploader.h"
+
+/**
+ * Constructs a `VolumeUploader`, making an empty texture the size of the volume.
+ *
+ * Float volumes are scanned for their range first, which reads the whole file.
+ *
+ * @param file Volume to upload, which the uploader takes ownership of
+ * @param unit Ordinal of texture unit to bind texture to
+ * @param storage Storage to keep the texture in
+ * @param reporting Whether to print the error made converting voxels once the upload finishes
+ * @param workerPool Workers to convert voxels with, which must outlive the uploader
+ * @throws std::invalid_argument if file is `NULL` or unit is negative
+ * @throws std::runtime_error if volume is larger than the largest 3D texture supported
+ * @throws std::runtime_error if a worker fails while finding the range
+ */
+VolumeUploader::VolumeUploader(VolumeFile* const file,
+                               const GLint unit,
+                               const Quantizer::Storage storage,
+                               const bool reporting,
+                               WorkerPool& workerPool) :
+        file(checkFile(file)),
+        unit(unit),
+        quantizer(*file, storage),
+        reporting(reporting),
+        workerPool(workerPool),
+        occupancyGrid(NULL),
+        pixelUnpackBuffer(Gloop::BufferTarget::pixelUnpackBuffer()),
+        texture(0),
+        layersPerSlab(1),
+        next(0),
+        buffer(0) {
+
+    // Check arguments and find range, closing the file if anything fails since it's already ours
+    try {
+        if (unit < 0) {
+            throw std::invalid_argument("[VolumeUploader] Texture unit is negative!");
+        }
+        GLint maxSize;
+        glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+        for (int i = 0; i < 3; ++i) {
+            if (file->getSize(i) > maxSize) {
+                throw std::runtime_error("[VolumeUploader] Volume is larger than largest 3D texture!");
+            }
+        }
+        if (!quantizer.isCopy()) {
+            quantizer.findRange(workerPool);
+        }
+    } catch (std::exception&) {
+        delete file;
+        throw;
+    }
+
+    // Make texture
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, quantizer.getFormat(),
+                 file->getSize(0), file->getSize(1), file->getSize(2), 0,
+                 GL_RED, quantizer.getType(), NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glActiveTexture(activeTexture);
+
+    // Make pixel buffers holding a slab of whole layers each
+    const size_t sizeOfLayer = ((size_t) file->getSize(0)) * file->getSize(1) * quantizer.getBytesPerVoxel();
+    if (sizeOfLayer < SIZE_OF_SLAB) {
+        layersPerSlab = SIZE_OF_SLAB / sizeOfLayer;
+    }
+    for (int i = 0; i < NUMBER_OF_BUFFERS; ++i) {
+        buffers.push_back(Gloop::BufferObject::generate());
+        pixelUnpackBuffer.bind(buffers[i]);
+        pixelUnpackBuffer.data(sizeOfLayer * layersPerSlab, NULL, GL_STREAM_DRAW);
+        fences[i] = NULL;
+    }
+    pixelUnpackBuffer.unbind(buffers.back());
+
+    // Start reading the first slabs from disk
+    file->prefetch(0, layersPerSlab * NUMBER_OF_BUFFERS);
+}
+
+/**
+ * Destructs a `VolumeUploader`, deleting its texture and closing its file.
+ */
+VolumeUploader::~VolumeUploader() {
+    for (int i = 0; i < NUMBER_OF_BUFFERS; ++i) {
+        if (fences[i] != NULL) {
+            glDeleteSync(fences[i]);
+        }
+        buffers[i].dispose();
+    }
+    glDeleteTextures(1, &texture);
+    delete file;
+}
+
+/**
+ * Binds the texture to its texture unit.
+ */
+void VolumeUploader::bind() const {
+    GLint activeTexture;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(activeTexture);
+}
+
+/**
+ * Makes sure a file was given.
+ *
+ * @param file File to check
+ * @return The file
+ * @throws std::invalid_argument if file is `NULL`
+ */
+VolumeFile* VolumeUploader::checkFile(VolumeFile* const file) {
+    if (file == NULL) {
+        throw std::invalid_argument("[VolumeUploader] File is NULL!");
+    }
+    return file;
+}
+
+/**
+ * Returns the volume being uploaded.
+ */
+const VolumeFile& VolumeUploader::getFile() const {
+    return *file;
+}
+
+/**
+ * Returns the converter used for voxels that don't match the storage of the texture.
+ */
+const Quantizer& VolumeUploader::getQuantizer() const {
+    return quantizer;
+}
+
+/**
+ * Returns the ordinal of the texture unit the texture is bound to.
+ */
+GLint VolumeUploader::getUnit() const {
+    return unit;
+}
+
+/**
+ * Checks if the volume has been completely sent to the texture.
+ */
+bool VolumeUploader::isComplete() const {
+    return next >= file->getSize(2);
+}
+
+/**
+ * Checks if the GPU is done transferring from a pixel buffer, without waiting.
+ *
+ * @param buffer Index of pixel buffer
+ * @return `true` if the pixel buffer can be written to
+ * @throws std::runtime_error if the fence could not be checked
+ */
+bool VolumeUploader::isDone(const int buffer) {
+
+    // Skip if never fenced
+    if (fences[buffer] == NULL) {
+        return true;
+    }
+
+    // Check fence, flushing in case it hasn't been sent yet
+    const GLenum result = glClientWaitSync(fences[buffer], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_WAIT_FAILED) {
+        throw std::runtime_error("[VolumeUploader] Could not check pixel buffer!");
+    } else if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    // Done with the fence
+    glDeleteSync(fences[buffer]);
+    fences[buffer] = NULL;
+    return true;
+}
+
+/**
+ * Changes the grid each slab is added to as it's sent, starting it over for the size of the volume.
+ *
+ * @param occupancyGrid Grid to add slabs to, or `NULL` for none
+ * @throws std::logic_error if some slabs have already been sent
+ */
+void VolumeUploader::setOccupancyGrid(OccupancyGrid* const occupancyGrid) {
+    if (next > 0) {
+        throw std::logic_error("[VolumeUploader] Upload has already started!");
+    }
+    if (occupancyGrid != NULL) {
+        occupancyGrid->begin(file->getSize(0), file->getSize(1), file->getSize(2));
+    }
+    this->occupancyGrid = occupancyGrid;
+}
+
+/**
+ * Binds the texture and sends it as many slabs as there are free pixel buffers.
+ *
+ * Must be called from the rendering thread.
+ *
+ * @return `true` if the last slab was just sent
+ * @throws std::runtime_error if a pixel buffer could not be mapped
+ */
+bool VolumeUploader::update() {
+
+    bind();
+
+    // Skip if already done
+    if (isComplete()) {
+        return false;
+    }
+
+    // Set up unpacking from tightly packed layers
+    GLint activeTexture, unpackAlignment, unpackSwapBytes;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glGetIntegerv(GL_UNPACK_SWAP_BYTES, &unpackSwapBytes);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_SWAP_BYTES, (quantizer.isCopy() && file->isSwapped()) ? GL_TRUE : GL_FALSE);
+
+    // Send slabs while pixel buffers are free
+    const size_t voxelsPerLayer = ((size_t) file->getSize(0)) * file->getSize(1);
+    for (int i = 0; (i < NUMBER_OF_BUFFERS) && !isComplete() && isDone(buffer); ++i) {
+
+        // Copy slab out of the mapping, converting it if needed
+        const int remaining = file->getSize(2) - next;
+        const int layers = (remaining < layersPerSlab) ? remaining : layersPerSlab;
+        const GLsizeiptr size = voxelsPerLayer * layers * quantizer.getBytesPerVoxel();
+        pixelUnpackBuffer.bind(buffers[buffer]);
+        const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+        GLvoid* const ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, access);
+        if (ptr == NULL) {
+            pixelUnpackBuffer.unbind(buffers[buffer]);
+            throw std::runtime_error("[VolumeUploader] Could not map pixel buffer!");
+        }
+        if (quantizer.isCopy()) {
+            memcpy(ptr, file->getLayer(next), size);
+        } else {
+            quantizer.quantize(file->getLayer(next), voxelsPerLayer * layers, ptr, workerPool);
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        if (occupancyGrid != NULL) {
+            occupancyGrid->add(*file, quantizer, next, layers, workerPool);
+        }
+
+        // Start transfer into the texture, and fence off the buffer until it's done
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, next,
+                        file->getSize(0), file->getSize(1), layers,
+                        GL_RED, quantizer.getType(), NULL);
+        fences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pixelUnpackBuffer.unbind(buffers[buffer]);
+
+        // Move on, and have the system read ahead while the GPU works
+        next += layers;
+        buffer = (buffer + 1) % NUMBER_OF_BUFFERS;
+        file->prefetch(next + (layersPerSlab * (NUMBER_OF_BUFFERS - 1)), layersPerSlab);
+    }
+
+    // Restore state
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glPixelStorei(GL_UNPACK_SWAP_BYTES, unpackSwapBytes);
+    glActiveTexture(activeTexture);
+
+    // Report once done
+    if (!isComplete()) {
+        return false;
+    }
+    if (reporting) {
+        report();
+    }
+    return true;
+}
+
+/**
+ * Prints how much error was made converting voxels.
+ */
+void VolumeUploader::report() const {
+    if (quantizer.isCopy()) {
+        std::cout << "[VolumeUploader] Voxels were copied without error" << std::endl;
+    } else {
+        std::cout << "[VolumeUploader] Voxels were converted with a maximum error of " << quantizer.getMaxError()
+                  << " and an RMS error of " << quantizer.getRmsError() << std::endl;
+    }
+}
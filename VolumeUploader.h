@@ -0,0 +1,86 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_VOLUME_UPLOADER_H
+#define GANDER_VOLUME_UPLOADER_H
+#include <vector>
+#include <GL/glfw.h>
+#include <gloop/BufferObject.hxx>
+#include <gloop/BufferTarget.hxx>
+#include "Quantizer.h"
+#include "VolumeFile.h"
+#include "WorkerPool.h"
+class OccupancyGrid;
+
+
+/**
+ * 3D texture filled from a volume file a slab of layers at a time.
+ *
+ * Each call to `update` copies the next few slabs out of the file's mapping into a ring of pixel buffer
+ * objects and starts transfers from them into the texture, so the volume can be drawn while the rest of it
+ * is still arriving.  A pixel buffer is only reused once the GPU has finished the transfer from it, and
+ * `update` stops early instead of waiting.  Layers that haven't arrived yet are whatever the driver filled
+ * the texture with, normally zero.
+ *
+ * Voxels that don't match the requested storage are converted by a `Quantizer` on a pool of workers as they
+ * are copied into the pixel buffers, and the error it made can be printed once the upload finishes.  The pool
+ * is passed in so every uploader can share the same one.  Each slab can also be added to an `OccupancyGrid`
+ * straight from the file, so the grid is ready when the upload finishes without reading the texture back.
+ */
+class VolumeUploader {
+public:
+// Methods
+    VolumeUploader(VolumeFile* file,
+                   GLint unit,
+                   Quantizer::Storage storage,
+                   bool reporting,
+                   WorkerPool& workerPool);
+    virtual ~VolumeUploader();
+    const VolumeFile& getFile() const;
+    const Quantizer& getQuantizer() const;
+    GLint getUnit() const;
+    bool isComplete() const;
+    void setOccupancyGrid(OccupancyGrid* occupancyGrid);
+    bool update();
+private:
+// Constants
+    static const int NUMBER_OF_BUFFERS = 3;
+    static const size_t SIZE_OF_SLAB = 16 * 1024 * 1024;
+// Attributes
+    VolumeFile* const file;
+    const GLint unit;
+    Quantizer quantizer;
+    const bool reporting;
+    WorkerPool& workerPool;
+    OccupancyGrid* occupancyGrid;
+    const Gloop::BufferTarget pixelUnpackBuffer;
+    std::vector<Gloop::BufferObject> buffers;
+    GLsync fences[NUMBER_OF_BUFFERS];
+    GLuint texture;
+    int layersPerSlab;
+    int next;
+    int buffer;
+// Methods
+    VolumeUploader(const VolumeUploader&);
+    VolumeUploader& operator=(const VolumeUploader&);
+    void bind() const;
+    static VolumeFile* checkFile(VolumeFile* file);
+    bool isDone(int buffer);
+    void report() const;
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+#include <exception>
+#include <stdexcept>
+#include <Poco/Environment.h>
+#include "WorkerPool.h"
+
+/**
+ * Constructs a `WorkerPool` with one worker for each processor.
+ */
+WorkerPool::WorkerPool() :
+        numberOfWorkers(getNumberOfProcessors()),
+        threadPool(numberOfWorkers > 1 ? numberOfWorkers - 1 : 1, numberOfWorkers > 1 ? numberOfWorkers - 1 : 1) {
+    for (int i = 0; i < numberOfWorkers; ++i) {
+        workers.push_back(Worker(i, numberOfWorkers));
+    }
+}
+
+/**
+ * Constructs a `WorkerPool` with a specific number of workers.
+ *
+ * @param numberOfWorkers Number of workers, including the calling thread
+ * @throws std::invalid_argument if number of workers is not positive
+ */
+WorkerPool::WorkerPool(const int numberOfWorkers) :
+        numberOfWorkers(checkNumberOfWorkers(numberOfWorkers)),
+        threadPool(numberOfWorkers > 1 ? numberOfWorkers - 1 : 1, numberOfWorkers > 1 ? numberOfWorkers - 1 : 1) {
+    for (int i = 0; i < numberOfWorkers; ++i) {
+        workers.push_back(Worker(i, numberOfWorkers));
+    }
+}
+
+/**
+ * Destructs a `WorkerPool`.
+ */
+WorkerPool::~WorkerPool() {
+    threadPool.joinAll();
+}
+
+/**
+ * Checks a number of workers.
+ *
+ * @param numberOfWorkers Number of workers to check
+ * @return The number of workers
+ * @throws std::invalid_argument if number of workers is not positive
+ */
+int WorkerPool::checkNumberOfWorkers(const int numberOfWorkers) {
+    if (numberOfWorkers < 1) {
+        throw std::invalid_argument("[WorkerPool] Number of workers is not positive!");
+    }
+    return numberOfWorkers;
+}
+
+/**
+ * Returns the pool shared by the whole program, starting it the first time.
+ *
+ * @return Pool with one worker for each processor
+ */
+WorkerPool& WorkerPool::getInstance() {
+    static WorkerPool instance;
+    return instance;
+}
+
+/**
+ * Determines how many processors are available.
+ *
+ * @return Number of processors, at least one
+ */
+int WorkerPool::getNumberOfProcessors() {
+    const int numberOfProcessors = Poco::Environment::processorCount();
+    return (numberOfProcessors > 1) ? numberOfProcessors : 1;
+}
+
+/**
+ * Returns the number of workers, including the calling thread.
+ */
+int WorkerPool::getNumberOfWorkers() const {
+    return numberOfWorkers;
+}
+
+/**
+ * Splits a job between the workers and waits for all of them to finish.
+ *
+ * @param job Job to run
+ * @throws std::runtime_error if any worker failed
+ */
+void WorkerPool::run(Job& job) {
+
+    // Hand the job to every worker
+    for (std::vector<Worker>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        it->setJob(&job);
+    }
+
+    // Start the other workers, then do the first share here
+    for (int i = 1; i < numberOfWorkers; ++i) {
+        threadPool.start(workers[i]);
+    }
+    workers[0].run();
+    threadPool.joinAll();
+
+    // Report the first failure
+    for (std::vector<Worker>::const_iterator it = workers.begin(); it != workers.end(); ++it) {
+        if (!it->getError().empty()) {
+            throw std::runtime_error("[WorkerPool] " + it->getError());
+        }
+    }
+}
+
+/**
+ * Constructs a `Worker`.
+ *
+ * @param index Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+WorkerPool::Worker::Worker(const int index, const int numberOfWorkers) :
+        index(index),
+        numberOfWorkers(numberOfWorkers),
+        job(NULL) {
+    // empty
+}
+
+/**
+ * Returns the message of the exception thrown by the last job, or an empty string if it succeeded.
+ */
+const std::string& WorkerPool::Worker::getError() const {
+    return error;
+}
+
+/**
+ * Executes this worker's share of the job, catching anything it throws.
+ */
+void WorkerPool::Worker::run() {
+    try {
+        job->execute(index, numberOfWorkers);
+    } catch (std::exception& e) {
+        error = e.what();
+    } catch (...) {
+        error = "Unknown error in worker!";
+    }
+}
+
+/**
+ * Changes the job this worker executes and clears its last error.
+ *
+ * @param job Job to execute
+ */
+void WorkerPool::Worker::setJob(Job* const job) {
+    this->job = job;
+    this->error.clear();
+}
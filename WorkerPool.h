@@ -0,0 +1,125 @@
+/*
+ * Gander - Scene renderer for prototyping OpenGL and GLSL
+ * Copyright (C) 2013  Andrew Brown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GANDER_WORKER_POOL_H
+#define GANDER_WORKER_POOL_H
+#include <string>
+#include <vector>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+
+
+/**
+ * Fixed set of threads that split a job between them.
+ *
+ * The calling thread takes the first share of each job itself, and `run`
+ * only returns once every worker has finished its share.
+ *
+ * Everything that splits work on the rendering thread should share the
+ * pool from `getInstance`, so loading several volumes at once doesn't
+ * start more threads than there are processors.  A pool runs one job at
+ * a time, so it must only be used from one thread.
+ */
+class WorkerPool {
+public:
+// Types
+    class Job {
+    public:
+        virtual ~Job() {}
+        virtual void execute(int worker, int numberOfWorkers) = 0;
+    };
+// Methods
+    WorkerPool();
+    explicit WorkerPool(int numberOfWorkers);
+    virtual ~WorkerPool();
+    static WorkerPool& getInstance();
+    int getNumberOfWorkers() const;
+    void run(Job& job);
+    template<typename T> void run(T* object, void (T::*method)(int, int));
+private:
+// Types
+    class Worker : public Poco::Runnable {
+    public:
+        Worker(int index, int numberOfWorkers);
+        const std::string& getError() const;
+        virtual void run();
+        void setJob(Job* job);
+    private:
+        int index;
+        int numberOfWorkers;
+        Job* job;
+        std::string error;
+    };
+    template<typename T>
+    class MethodJob : public Job {
+    public:
+        MethodJob(T* object, void (T::*method)(int, int));
+        virtual void execute(int worker, int numberOfWorkers);
+    private:
+        T* const object;
+        void (T::*method)(int, int);
+    };
+// Attributes
+    const int numberOfWorkers;
+    Poco::ThreadPool threadPool;
+    std::vector<Worker> workers;
+// Methods
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+    static int checkNumberOfWorkers(int numberOfWorkers);
+    static int getNumberOfProcessors();
+};
+
+
+/**
+ * Splits a call to a method between the workers.
+ *
+ * @param object Object to call method on
+ * @param method Method taking index of worker and number of workers
+ * @throws std::runtime_error if any worker failed
+ */
+template<typename T>
+void WorkerPool::run(T* const object, void (T::*method)(int, int)) {
+    MethodJob<T> job(object, method);
+    run(job);
+}
+
+/**
+ * Constructs a `MethodJob`.
+ *
+ * @param object Object to call method on
+ * @param method Method to call
+ */
+template<typename T>
+WorkerPool::MethodJob<T>::MethodJob(T* const object, void (T::*method)(int, int)) :
+        object(object),
+        method(method) {
+    // empty
+}
+
+/**
+ * Calls the method for one worker.
+ *
+ * @param worker Index of worker
+ * @param numberOfWorkers Total number of workers
+ */
+template<typename T>
+void WorkerPool::MethodJob<T>::execute(const int worker, const int numberOfWorkers) {
+    (object->*method)(worker, numberOfWorkers);
+}
+
+#endif
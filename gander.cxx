@@ -16,12 +16,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "config.h"
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <GL/glfw.h>
 #include <glycerin/Projection.hxx>
 #include <glycerin/TextRenderer.hxx>
@@ -54,12 +56,17 @@
 #include <RapidGL/Visitor.h>
 #include <RapidGL/UniformNodeUnmarshaller.h>
 #include <RapidGL/UseNodeUnmarshaller.h>
+#include "BrickFile.h"
 #include "Picker.h"
+#include "SliceBenchmark.h"
+#include "SceneUtility.h"
 #include "Sphere.h"
 #include "WindowAdapter.h"
 #include "BlendNodeUnmarshaller.h"
 #include "BooleanAndNodeUnmarshaller.h"
 #include "BooleanXorNodeUnmarshaller.h"
+#include "PreIntegrationNodeUnmarshaller.h"
+#include "RayCastingVolumeRendererNodeUnmarshaller.h"
 #include "SlicingVolumeRendererNodeUnmarshaller.h"
 #include "SortNodeUnmarshaller.h"
 #include "VolumeNodeUnmarshaller.h"
@@ -72,7 +79,7 @@
 class Gander : public WindowAdapter {
 public:
 // Methods
-    Gander(const std::string& filename);
+    Gander(const std::string& filename, bool comparing);
     void run();
 protected:
 // Methods
@@ -95,6 +102,12 @@ private:
     Glycerin::TextRenderer *textRenderer;
     int frames;
     std::string framesPerSecond;
+    const bool comparing;
+    bool rayCasting;
+    std::vector<SlicingVolumeRendererNode*> slicingNodes;
+    std::vector<RayCastingVolumeRendererNode*> rayCastingNodes;
+    std::string slicingFramesPerSecond;
+    std::string rayCastingFramesPerSecond;
 // Methods
     static Glycerin::Ray createRay(int x, int y);
     static Glycerin::Ray createRayAlt(int x, int y);
@@ -104,15 +117,17 @@ private:
     void move(int x, int y);
     void rightMousePressed(int x, int y);
     void rotate(int x, int y);
+    void setRayCasting(bool rayCasting);
 };
 
 /**
  * Constructs the application.
  *
  * @param filename Path to the file to open
+ * @param comparing Whether to alternate between slicing and ray casting to compare their speed
  * @throws std::runtime_error
  */
-Gander::Gander(const std::string& filename) : WindowAdapter(filename),
+Gander::Gander(const std::string& filename, const bool comparing) : WindowAdapter(filename),
         filename(filename),
         root(NULL),
         zoom(-5.0),
@@ -123,7 +138,11 @@ Gander::Gander(const std::string& filename) : WindowAdapter(filename),
         previousY(0),
         frames(0),
         framesPerSecond("0 fps"),
-        textRenderer(NULL) {
+        textRenderer(NULL),
+        comparing(comparing),
+        rayCasting(false),
+        slicingFramesPerSecond("?"),
+        rayCastingFramesPerSecond("?") {
     reader.addUnmarshaller("attribute", new RapidGL::AttributeNodeUnmarshaller());
     reader.addUnmarshaller("attachment", new RapidGL::AttachmentNodeUnmarshaller());
     reader.addUnmarshaller("blend", new BlendNodeUnmarshaller());
@@ -137,7 +156,9 @@ Gander::Gander(const std::string& filename) : WindowAdapter(filename),
     reader.addUnmarshaller("group", new RapidGL::GroupNodeUnmarshaller());
     reader.addUnmarshaller("instance", new RapidGL::InstanceNodeUnmarshaller());
     reader.addUnmarshaller("polygon", new RapidGL::PolygonModeNodeUnmarshaller());
+    reader.addUnmarshaller("preIntegration", new PreIntegrationNodeUnmarshaller());
     reader.addUnmarshaller("program", new RapidGL::ProgramNodeUnmarshaller());
+    reader.addUnmarshaller("rayCastingVolumeRenderer", new RayCastingVolumeRendererNodeUnmarshaller());
     reader.addUnmarshaller("renderbuffer", new RapidGL::RenderbufferNodeUnmarshaller());
     reader.addUnmarshaller("rotate", new RapidGL::RotateNodeUnmarshaller());
     reader.addUnmarshaller("scale", new RapidGL::ScaleNodeUnmarshaller());
@@ -286,6 +307,16 @@ void Gander::opened() {
     // Read file
     root = reader.read(file);
 
+    // Start with slicing if comparing techniques
+    if (comparing) {
+        slicingNodes = SceneUtility::findDescendants<SlicingVolumeRendererNode>(root);
+        rayCastingNodes = SceneUtility::findDescendants<RayCastingVolumeRendererNode>(root);
+        if (slicingNodes.empty() || rayCastingNodes.empty()) {
+            throw std::runtime_error("Comparing needs both a slicing and a ray casting volume renderer!");
+        }
+        setRayCasting(false);
+    }
+
     // Enable depth
     glEnable(GL_DEPTH_TEST);
 
@@ -316,6 +347,17 @@ void Gander::paint() {
         stream << ((int) ((((double) frames) / time) + 0.5)) << " fps";
         framesPerSecond = stream.str();
         frames = 0;
+
+        // Switch techniques after each measurement when comparing
+        if (comparing) {
+            if (rayCasting) {
+                rayCastingFramesPerSecond = framesPerSecond;
+            } else {
+                slicingFramesPerSecond = framesPerSecond;
+            }
+            setRayCasting(!rayCasting);
+            framesPerSecond = "slicing " + slicingFramesPerSecond + ", ray casting " + rayCastingFramesPerSecond;
+        }
     }
 
     // Draw text
@@ -383,6 +425,22 @@ void Gander::rotate(const int x, const int y) {
     rotation = rot * rotation;
 }
 
+/**
+ * Changes which volume renderers are drawn when comparing techniques.
+ *
+ * @param rayCasting `true` to draw only ray casting renderers, `false` to draw only slicing renderers
+ */
+void Gander::setRayCasting(const bool rayCasting) {
+    this->rayCasting = rayCasting;
+    for (std::vector<SlicingVolumeRendererNode*>::iterator it = slicingNodes.begin(); it != slicingNodes.end(); ++it) {
+        (*it)->setEnabled(!rayCasting);
+    }
+    typedef std::vector<RayCastingVolumeRendererNode*>::iterator iterator_t;
+    for (iterator_t it = rayCastingNodes.begin(); it != rayCastingNodes.end(); ++it) {
+        (*it)->setEnabled(rayCasting);
+    }
+}
+
 /**
  * Runs the application.
  */
@@ -393,15 +451,41 @@ void Gander::run() {
 int main(int argc, char* argv[]) {
 
     // Check for arguments
-    if (argc != 2) {
+    const bool comparing = (argc == 3) && (std::string(argv[1]) == "--compare");
+    const bool bricking = (argc == 8) && (std::string(argv[1]) == "--brick");
+    const bool benchmarking = (argc == 2) && (std::string(argv[1]) == "--benchmark");
+    if ((argc != 2) && !comparing && !bricking) {
         std::cout << "Usage:" << std::endl;
-        std::cout << argv[0] << " <file>" << std::endl;
+        std::cout << argv[0] << " [--compare] <file>" << std::endl;
+        std::cout << argv[0] << " --brick <raw> <width> <height> <depth> <size> <file>" << std::endl;
+        std::cout << argv[0] << " --benchmark" << std::endl;
+        return 0;
+    }
+
+    // Time the slicing kernels against the old way of slicing instead of opening a scene
+    if (benchmarking) {
+        try {
+            return SliceBenchmark::run(std::cout) ? 0 : 1;
+        } catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Split a raw volume into a brick file instead of opening a scene
+    if (bricking) {
+        try {
+            BrickFile::create(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]), argv[7]);
+        } catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
         return 0;
     }
 
     // Make application
     try {
-        Gander gander(argv[1]);
+        Gander gander(argv[argc - 1], comparing);
         gander.run();
     } catch (std::exception& e) {
         std::cerr << e.what() << std::endl;